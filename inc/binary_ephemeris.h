@@ -0,0 +1,372 @@
+#ifndef ASTRO_BINARY_EPHEMERIS_H
+#define ASTRO_BINARY_EPHEMERIS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <vector>
+
+#include "ephemeris.h"
+#include "io_ephemeris.h"
+#include "mapped_file.h"
+#include "parallel.h"
+
+#define BINARY_EPHEM_MAGIC "ASTREPH"   // Eight bytes with the terminator
+#define BINARY_EPHEM_VERSION 1
+#define BINARY_EPHEM_BYTE_ORDER 0x01020304
+
+// Header flags
+#define BINARY_EPHEM_ACC 1
+
+/**
+ * Fixed size header at the start of a binary ephemeris file
+ *
+ * The header is followed by packed arrays in native byte order, each
+ * starting on an 8 byte boundary at the offset given here:
+ *   - whole seconds since 1950 of every sample time, int32
+ *   - fractional seconds of every sample time, double
+ *   - positions as x, y, z per sample, double
+ *   - velocities as x, y, z per sample, double
+ *   - accelerations as x, y, z per sample, double, only with BINARY_EPHEM_ACC
+ *
+ * Times are stored exactly as Timecode holds them, so a file reads back into
+ * the ephemeris it was written from bit for bit. The version changes whenever
+ * the layout does.
+ */
+struct BinaryEphemHeader {
+    char magic_[8];
+    uint32_t version_;
+    uint32_t byteOrder_;      // BINARY_EPHEM_BYTE_ORDER as written
+    uint32_t headerSize_;
+    uint32_t flags_;
+    int32_t csystem_;
+    int32_t interpMethod_;
+    int32_t csystemEpochWhole_;
+    int32_t reserved_;
+    double csystemEpochFract_;
+    int64_t count_;
+    double step_;             // Sample spacing in seconds, zero if not uniform
+    uint64_t wholeOffset_;
+    uint64_t fractOffset_;
+    uint64_t posOffset_;
+    uint64_t velOffset_;
+    uint64_t accOffset_;      // Zero without accelerations
+    char padding_[24];
+};
+
+static_assert(sizeof(BinaryEphemHeader) == 128, "Binary ephemeris header must be 128 bytes");
+
+/**
+ * Gets the sample spacing of an ephemeris
+ *
+ * @param Ephemeris to check
+ *
+ * @return Spacing in seconds if every sample is within 1e-9 steps of a
+ *         uniform grid, otherwise zero
+ */
+inline double uniformStep(const Ephemeris& ephem) {
+    const std::vector<StateVec>& states = ephem.states_;
+    int nn = states.size();
+    if (nn < 2) return 0;
+
+    double step = (states[nn-1].tc_ - states[0].tc_)/(nn-1);
+    if (!(step > 0)) return 0;
+    for (int ii = 1; ii < nn; ii++) {
+        double err = (states[ii].tc_ - states[0].tc_) - ii*step;
+        if (fabs(err) > 1e-9*step) return 0;
+    }
+    return step;
+}
+
+/**
+ * Writes an ephemeris to a binary ephemeris file
+ *
+ * See BinaryEphemHeader for the layout.
+ *
+ * @param File to write
+ * @param Ephemeris to write
+ *
+ * @return True if the file was written
+ */
+inline bool writeEphemToBinary(std::string outfile, const Ephemeris& ephem) {
+    const std::vector<StateVec>& states = ephem.states_;
+    uint64_t count = states.size();
+
+    BinaryEphemHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic_, BINARY_EPHEM_MAGIC, sizeof(header.magic_));
+    header.version_ = BINARY_EPHEM_VERSION;
+    header.byteOrder_ = BINARY_EPHEM_BYTE_ORDER;
+    header.headerSize_ = sizeof(header);
+    header.flags_ = ephem.accValid_ ? BINARY_EPHEM_ACC : 0;
+    header.csystem_ = ephem.csystem_;
+    header.interpMethod_ = ephem.interpMethod_;
+    header.csystemEpochWhole_ = ephem.csystemEpoch_.getWhole();
+    header.csystemEpochFract_ = ephem.csystemEpoch_.getFract();
+    header.count_ = count;
+    header.step_ = uniformStep(ephem);
+    header.wholeOffset_ = sizeof(header);
+    header.fractOffset_ = header.wholeOffset_ + (count*sizeof(int32_t) + 7)/8*8;
+    header.posOffset_ = header.fractOffset_ + count*sizeof(double);
+    header.velOffset_ = header.posOffset_ + 3*count*sizeof(double);
+    header.accOffset_ = ephem.accValid_ ? header.velOffset_ + 3*count*sizeof(double) : 0;
+
+    FILE* fp = fopen(outfile.c_str(), "wb");
+    if (fp == NULL) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+
+    // Each array is gathered a block of samples at a time
+    const size_t block = 8192;
+    std::vector<char> buffer(block*3*sizeof(double));
+    for (int array = 0; array < 5 && ok; array++) {
+        if (array == 4 && !ephem.accValid_) break;
+
+        for (size_t begin = 0; begin < count && ok; begin += block) {
+            size_t end = std::min((size_t)count, begin + block);
+            size_t len = 0;
+            if (array == 0) {
+                int32_t* out = (int32_t*)&buffer[0];
+                for (size_t ii = begin; ii < end; ii++) out[ii - begin] = states[ii].tc_.getWhole();
+                len = (end - begin)*sizeof(int32_t);
+            } else if (array == 1) {
+                double* out = (double*)&buffer[0];
+                for (size_t ii = begin; ii < end; ii++) out[ii - begin] = states[ii].tc_.getFract();
+                len = (end - begin)*sizeof(double);
+            } else {
+                double* out = (double*)&buffer[0];
+                for (size_t ii = begin; ii < end; ii++) {
+                    const Vec3& vec = (array == 2) ? states[ii].pos_ : (array == 3) ? states[ii].vel_ : states[ii].acc_;
+                    out[3*(ii - begin)] = vec.x_;
+                    out[3*(ii - begin) + 1] = vec.y_;
+                    out[3*(ii - begin) + 2] = vec.z_;
+                }
+                len = 3*(end - begin)*sizeof(double);
+            }
+            ok = fwrite(&buffer[0], 1, len, fp) == len;
+        }
+
+        // Pad the time seconds out to the next array's alignment
+        if (array == 0 && ok) {
+            size_t pad = header.fractOffset_ - header.wholeOffset_ - count*sizeof(int32_t);
+            char zeros[8] = {0};
+            ok = fwrite(zeros, 1, pad, fp) == pad;
+        }
+    }
+
+    if (fclose(fp) != 0) ok = false;
+    return ok;
+}
+
+class EphemerisView;
+int sampleLowerBound(const EphemerisView& src, Timecode tc);
+
+/**
+ * Read only ephemeris backed by a memory mapped binary ephemeris file
+ *
+ * Opening a file only maps it and checks the header, and states are read
+ * straight out of the mapping, so opening costs the same for any size of file
+ * and interpolation only pages in the samples around the requested times.
+ * Interpolation runs the same SampleCursor as Ephemeris, so results are
+ * identical to reading the file into an Ephemeris and interpolating that.
+ * Files with a uniform step find samples from the step instead of searching.
+ *
+ * Concurrent queries from several threads are safe, each with its own cursor.
+ */
+class EphemerisView {
+    public:
+        /**
+         * Maps a binary ephemeris file, throwing if it is not one or is truncated
+         *
+         * @param File to map
+         */
+        EphemerisView(std::string filename) : file_(filename) {
+            file_.advise(MADV_RANDOM);
+
+            BinaryEphemHeader header;
+            if (file_.size() < sizeof(header)) throw "Not a binary ephemeris file";
+            memcpy(&header, file_.data(), sizeof(header));
+            if (memcmp(header.magic_, BINARY_EPHEM_MAGIC, sizeof(header.magic_)) != 0) {
+                throw "Not a binary ephemeris file";
+            }
+            if (header.byteOrder_ != BINARY_EPHEM_BYTE_ORDER) throw "Binary ephemeris has a different byte order";
+            if (header.version_ != BINARY_EPHEM_VERSION) throw "Unsupported binary ephemeris version";
+            if (header.count_ < 0 || header.count_ > INT_MAX) throw "Invalid binary ephemeris size";
+            if (header.interpMethod_ < LAGRANGE || header.interpMethod_ > HERMITE) {
+                throw "Unknown interpolation method in binary ephemeris";
+            }
+            if (header.csystem_ < FIXED || header.csystem_ > J2000) throw "Unknown coordinate system in binary ephemeris";
+
+            count_ = header.count_;
+            step_ = header.step_;
+            accValid_ = (header.flags_ & BINARY_EPHEM_ACC) != 0;
+            interpMethod_ = (InterpMethod)header.interpMethod_;
+            csystem_ = (CoordSystem)header.csystem_;
+            csystemEpoch_ = Timecode(header.csystemEpochWhole_, header.csystemEpochFract_);
+
+            whole_ = (const int32_t*)array(header.wholeOffset_, (size_t)count_*sizeof(int32_t));
+            fract_ = (const double*)array(header.fractOffset_, (size_t)count_*sizeof(double));
+            pos_ = (const double*)array(header.posOffset_, 3*(size_t)count_*sizeof(double));
+            vel_ = (const double*)array(header.velOffset_, 3*(size_t)count_*sizeof(double));
+            acc_ = accValid_ ? (const double*)array(header.accOffset_, 3*(size_t)count_*sizeof(double)) : NULL;
+        }
+
+        typedef SampleCursor<EphemerisView> Cursor;
+
+        /**
+         * Gets the number of samples
+         */
+        int numStates() const {
+            return count_;
+        }
+
+        /**
+         * Gets the sample spacing in seconds, zero if it isn't uniform
+         */
+        double step() const {
+            return step_;
+        }
+
+        /**
+         * Gets the time of a sample
+         */
+        Timecode stateTime(int idx) const {
+            return Timecode(whole_[idx], fract_[idx]);
+        }
+
+        /**
+         * Finds the first sample at or after a time
+         *
+         * With a uniform step the index comes straight from the time and is
+         * checked against its neighbours, otherwise the samples are searched.
+         *
+         * @param Time to look for
+         *
+         * @return Index of the first sample not before the time, or
+         *         numStates() if every sample is before it
+         */
+        int lowerBound(Timecode tc) const {
+            if (step_ > 0) {
+                double guess = ceil((tc - stateTime(0))/step_);
+                if (guess < 0) guess = 0;
+                if (guess > count_) guess = count_;
+                for (int idx = (int)guess - 1; idx <= (int)guess + 1; idx++) {
+                    if (idx < 0 || idx > count_) continue;
+                    if ((idx == 0 || stateTime(idx-1) < tc) && (idx == count_ || !(stateTime(idx) < tc))) {
+                        return idx;
+                    }
+                }
+            }
+            return sampleLowerBound<EphemerisView>(*this, tc);
+        }
+
+        /**
+         * Gets a sample
+         */
+        StateVec getState(int idx) const {
+            StateVec sv;
+            sv.tc_ = stateTime(idx);
+            size_t off = 3*(size_t)idx;
+            sv.pos_ = Vec3(pos_[off], pos_[off + 1], pos_[off + 2]);
+            sv.vel_ = Vec3(vel_[off], vel_[off + 1], vel_[off + 2]);
+            if (acc_ != NULL) sv.acc_ = Vec3(acc_[off], acc_[off + 1], acc_[off + 2]);
+            return sv;
+        }
+
+        /**
+         * Interpolates the ephemeris to the given time using the ephemeris
+         * interpolation method
+         *
+         * For many queries at increasing times use a Cursor instead.
+         *
+         * @param Time to interpolate to
+         * @param Number of points to use in interpolation
+         *
+         * @return The interpolated state at the given time
+         */
+        StateVec getSV(Timecode tc, int numpts = 4) const {
+            Cursor cursor(*this);
+            return cursor.getSV(tc, numpts);
+        }
+
+        /**
+         * Copies every sample into an in memory ephemeris
+         *
+         * @param Number of threads, zero or less for one per hardware thread
+         *
+         * @return Ephemeris with the same samples and settings
+         */
+        Ephemeris toEphemeris(int nthreads = 1) const {
+            Ephemeris ephem;
+            ephem.accValid_ = accValid_;
+            ephem.interpMethod_ = interpMethod_;
+            ephem.csystem_ = csystem_;
+            ephem.csystemEpoch_ = csystemEpoch_;
+
+            std::vector<StateVec>& states = ephem.states_;
+            states.resize(count_);
+            parallelFor(count_, nthreads, [&](long begin, long end) {
+                for (long ii = begin; ii < end; ii++) states[ii] = getState(ii);
+            });
+            return ephem;
+        }
+
+    private:
+        const char* array(uint64_t offset, uint64_t size) const {
+            if (offset % 8 != 0 || offset > file_.size() || size > file_.size() - offset) {
+                throw "Truncated binary ephemeris file";
+            }
+            return file_.data() + offset;
+        }
+
+    public:
+        bool accValid_;
+        InterpMethod interpMethod_;
+
+        CoordSystem csystem_;
+        Timecode csystemEpoch_;
+
+    private:
+        MappedFile file_;
+        int count_;
+        double step_;
+        const int32_t* whole_;
+        const double* fract_;
+        const double* pos_;
+        const double* vel_;
+        const double* acc_;
+};
+
+/**
+ * Finds the first sample of a binary ephemeris view at or after a time using
+ * its uniform step, see EphemerisView::lowerBound
+ */
+inline int sampleLowerBound(const EphemerisView& src, Timecode tc) {
+    return src.lowerBound(tc);
+}
+
+/**
+ * Checks whether a file starts with the given eight byte magic
+ *
+ * @param File to check
+ * @param Magic to look for
+ */
+inline bool hasFileMagic(std::string filename, const char* magic) {
+    char buf[8];
+    FILE* fp = fopen(filename.c_str(), "rb");
+    if (fp == NULL) return false;
+    bool match = fread(buf, 1, sizeof(buf), fp) == sizeof(buf) && memcmp(buf, magic, sizeof(buf)) == 0;
+    fclose(fp);
+    return match;
+}
+
+/**
+ * Checks whether a file is a binary ephemeris file
+ *
+ * @param File to check
+ */
+inline bool isBinaryEphemFile(std::string filename) {
+    return hasFileMagic(filename, BINARY_EPHEM_MAGIC);
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef ASTRO_CHEBYSHEV_EPHEMERIS_H
+#define ASTRO_CHEBYSHEV_EPHEMERIS_H
+
+#include <vector>
+#include <math.h>
+
+#include "ephemeris.h"
+
+/**
+ * Ephemeris stored as fixed duration chebyshev segments, similar to SPK type 2
+ *
+ * Each segment holds chebyshev coefficients for the three position components
+ * over its time span. Velocity comes from the derivative of the position
+ * series. Finding the segment for a time is a single division and evaluating
+ * it costs the same regardless of how densely the source was sampled.
+ */
+class ChebyshevEphemeris {
+    public:
+        ChebyshevEphemeris() {
+            degree_ = 0;
+            segLength_ = 0;
+            numSegs_ = 0;
+            csystem_ = FIXED;
+        }
+
+        /**
+         * Fits chebyshev segments to an ephemeris
+         *
+         * The last segment is shortened to end at the last ephemeris point.
+         *
+         * @param Ephemeris to fit
+         * @param Duration of each segment in seconds
+         * @param Degree of the chebyshev series for each segment
+         * @param Number of points to use when interpolating the source ephemeris
+         */
+        ChebyshevEphemeris(const Ephemeris& ephem, double segLength, int degree = 12, int numpts = 8) {
+            if (ephem.states_.size() < 2) throw "Not enough ephemeris points to fit";
+            if (!(segLength > 0)) throw "Chebyshev segment length must be positive";
+            if (degree < 1) throw "Chebyshev degree must be positive";
+
+            degree_ = degree;
+            segLength_ = segLength;
+            csystem_ = ephem.csystem_;
+            csystemEpoch_ = ephem.csystemEpoch_;
+            tc0_ = ephem.states_.front().tc_;
+            tc1_ = ephem.states_.back().tc_;
+
+            numSegs_ = ceil((tc1_ - tc0_)/segLength_ - 1e-9);
+            if (numSegs_ < 1) numSegs_ = 1;
+
+            int ncoef = degree_ + 1;
+            coeffs_.assign(numSegs_*3*ncoef, 0.0);
+
+            // Sample the source at the chebyshev nodes of each segment, in
+            // increasing time order so the cursor only moves forward
+            Ephemeris::Cursor cursor(ephem);
+            std::vector<Vec3> fx(ncoef);
+            for (int seg = 0; seg < numSegs_; seg++) {
+                Timecode start = tc0_ + seg*segLength_;
+                double half = segmentLength(seg)/2;
+                for (int jj = ncoef-1; jj >= 0; jj--) {
+                    double xx = cos(M_PI*(jj + 0.5)/ncoef);
+                    fx[jj] = cursor.getSV(clamp(start + half*(xx + 1)), numpts).pos_;
+                }
+
+                double* coef = &coeffs_[seg*3*ncoef];
+                for (int kk = 0; kk < ncoef; kk++) {
+                    Vec3 sum;
+                    for (int jj = 0; jj < ncoef; jj++) {
+                        sum = sum + fx[jj]*cos(M_PI*kk*(jj + 0.5)/ncoef);
+                    }
+                    double scale = (kk == 0) ? 1.0/ncoef : 2.0/ncoef;
+                    for (int ii = 0; ii < 3; ii++) {
+                        coef[ii*ncoef + kk] = sum[ii]*scale;
+                    }
+                }
+            }
+        }
+
+        /**
+         * Evaluates the ephemeris at the given time
+         *
+         * @param Time to evaluate at
+         *
+         * @return The state at the given time
+         */
+        StateVec getSV(Timecode tc) const {
+            if (numSegs_ == 0) throw "No ephemeris points to interpolate";
+            if ((tc < tc0_ && tc != tc0_) || (tc > tc1_ && tc != tc1_)) {
+                throw "Requested time outside ephemeris time span";
+            }
+
+            // Segments are fixed length, so the index is a single division
+            int seg = (int)floor((tc - tc0_)/segLength_);
+            if (seg < 0) seg = 0;
+            if (seg > numSegs_-1) seg = numSegs_-1;
+
+            Timecode start = tc0_ + seg*segLength_;
+            double len = segmentLength(seg);
+            double xx = 2*(tc - start)/len - 1;
+
+            // Clenshaw recurrence for the series and its derivative
+            int ncoef = degree_ + 1;
+            const double* coef = &coeffs_[seg*3*ncoef];
+            StateVec ans;
+            ans.tc_ = tc;
+            for (int ii = 0; ii < 3; ii++) {
+                const double* cc = coef + ii*ncoef;
+                double b1 = 0, b2 = 0, d1 = 0, d2 = 0;
+                for (int kk = degree_; kk >= 1; kk--) {
+                    double bb = 2*xx*b1 - b2 + cc[kk];
+                    double dd = 2*b1 + 2*xx*d1 - d2;
+                    b2 = b1; b1 = bb;
+                    d2 = d1; d1 = dd;
+                }
+                ans.pos_[ii] = cc[0] + xx*b1 - b2;
+                ans.vel_[ii] = (b1 + xx*d1 - d2)*2/len;
+            }
+
+            return ans;
+        }
+
+        /**
+         * Gets the number of doubles used to store the coefficients
+         */
+        size_t numCoeffs() const {
+            return coeffs_.size();
+        }
+
+    private:
+        double segmentLength(int seg) const {
+            if (seg == numSegs_-1) return tc1_ - (tc0_ + seg*segLength_);
+            return segLength_;
+        }
+
+        Timecode clamp(Timecode tc) const {
+            if (tc < tc0_) return tc0_;
+            if (tc > tc1_) return tc1_;
+            return tc;
+        }
+
+    public:
+        int degree_;
+        double segLength_;
+        int numSegs_;
+        Timecode tc0_, tc1_;
+
+        CoordSystem csystem_;
+        Timecode csystemEpoch_;
+
+        // Coefficients ordered by segment, then position component, then degree
+        std::vector<double> coeffs_;
+};
+
+#endif
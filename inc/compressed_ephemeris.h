@@ -0,0 +1,684 @@
+#ifndef ASTRO_COMPRESSED_EPHEMERIS_H
+#define ASTRO_COMPRESSED_EPHEMERIS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <vector>
+
+#include "ephemeris.h"
+#include "io_ephemeris.h"
+#include "binary_ephemeris.h"
+#include "mapped_file.h"
+#include "parallel.h"
+
+#define COMPRESSED_EPHEM_MAGIC "ASTRCEP"   // Eight bytes with the terminator
+#define COMPRESSED_EPHEM_VERSION 2
+#define COMPRESSED_EPHEM_MAX_ORDER 8
+
+// Quantized values are kept within 2^53 so eighth differences fit an int64
+#define COMPRESSED_EPHEM_MAX_QUANTA 9007199254740992.0
+
+/**
+ * Settings for compressing an ephemeris
+ *
+ * Every position, velocity and acceleration component is rounded to a
+ * multiple of its quantum, so decoded values are within half a quantum of
+ * the originals, give or take a few ulps of the value from the double
+ * arithmetic. Times are rounded to whole ticks the same way. The defaults
+ * keep times and positions to the microsecond and micrometer resolution of
+ * AGI files.
+ */
+struct EphemCodecOptions {
+    EphemCodecOptions(double posQuantum = 1e-6, double velQuantum = 1e-9, double accQuantum = 1e-12, int blockSize = 1024, int64_t ticksPerSecond = 1000000) {
+        posQuantum_ = posQuantum;
+        velQuantum_ = velQuantum;
+        accQuantum_ = accQuantum;
+        blockSize_ = blockSize;
+        ticksPerSecond_ = ticksPerSecond;
+    }
+
+    double posQuantum_;
+    double velQuantum_;
+    double accQuantum_;
+    int blockSize_;             // Samples per independently decoded block
+    int64_t ticksPerSecond_;
+};
+
+/**
+ * Fixed size header at the start of a compressed ephemeris file
+ *
+ * The header is followed by the blocks and then an index of numBlocks_+1
+ * byte offsets, where block ii runs from index[ii] to index[ii+1], followed
+ * by the time tick of the first sample of each block so readers can find the
+ * block holding a time without decoding any. Each block
+ * holds blockSize_ samples (the last may hold fewer) as one column per
+ * element: time ticks since the epoch, then positions, velocities and
+ * optionally accelerations in quanta. A column is a byte with its finite
+ * difference order followed by one zigzag varint per sample, see
+ * encodeDiffColumn.
+ */
+struct CompressedEphemHeader {
+    char magic_[8];
+    uint32_t version_;
+    uint32_t byteOrder_;      // BINARY_EPHEM_BYTE_ORDER as written
+    uint32_t headerSize_;
+    uint32_t flags_;          // BINARY_EPHEM_ACC with accelerations
+    int32_t csystem_;
+    int32_t interpMethod_;
+    int32_t csystemEpochWhole_;
+    int32_t epochWhole_;      // Time of tick zero, the first sample
+    double csystemEpochFract_;
+    double epochFract_;
+    int64_t count_;
+    int64_t ticksPerSecond_;
+    double posQuantum_;
+    double velQuantum_;
+    double accQuantum_;
+    int32_t blockSize_;
+    int32_t numBlocks_;
+    uint64_t indexOffset_;
+    int64_t lastTick_;
+    char padding_[8];
+};
+
+static_assert(sizeof(CompressedEphemHeader) == 128, "Compressed ephemeris header must be 128 bytes");
+
+/**
+ * Gets the number of bytes putVarint writes for a value
+ */
+inline int varintSize(int64_t val) {
+    uint64_t zz = ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+    int size = 1;
+    while (zz >= 0x80) {
+        zz >>= 7;
+        size++;
+    }
+    return size;
+}
+
+/**
+ * Writes a signed value as a zigzag varint, seven bits per byte with the
+ * high bit set on all but the last byte
+ *
+ * @param Output buffer with room for ten bytes
+ * @param Value to write
+ *
+ * @return One past the last byte written
+ */
+inline uint8_t* putVarint(uint8_t* out, int64_t val) {
+    uint64_t zz = ((uint64_t)val << 1) ^ (uint64_t)(val >> 63);
+    while (zz >= 0x80) {
+        *out++ = (uint8_t)(zz | 0x80);
+        zz >>= 7;
+    }
+    *out++ = (uint8_t)zz;
+    return out;
+}
+
+/**
+ * Reads a zigzag varint written by putVarint
+ *
+ * @param Start of the varint
+ * @param End of the buffer
+ * @param Output value
+ *
+ * @return One past the varint, or NULL if it runs past the end of the buffer
+ */
+inline const uint8_t* getVarint(const uint8_t* pos, const uint8_t* end, int64_t* val) {
+    uint64_t zz = 0;
+    for (int shift = 0; pos < end && shift < 64; shift += 7) {
+        uint8_t byte = *pos++;
+        zz |= (uint64_t)(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            *val = (int64_t)(zz >> 1) ^ -(int64_t)(zz & 1);
+            return pos;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Replaces a column of values with its finite differences of the given order
+ *
+ * Sample ii becomes its difference of order min(ii, order), which is the
+ * error of extrapolating it with a polynomial through the previous samples,
+ * so smooth columns turn into small residuals. Sample zero is kept as is.
+ *
+ * @param Values, differenced in place
+ * @param Number of values
+ * @param Order the values were differenced to so far
+ * @param Order to difference to
+ */
+inline void diffColumn(int64_t* vals, int count, int from, int order) {
+    for (int kk = from + 1; kk <= order; kk++) {
+        for (int ii = count-1; ii >= kk; ii--) {
+            vals[ii] -= vals[ii-1];
+        }
+    }
+}
+
+/**
+ * Codes a column of integers as finite differences, picking the order that
+ * takes the fewest bytes
+ *
+ * @param Values to code
+ * @param Number of values
+ * @param Output buffer, with room for 1 + 10*count more bytes
+ *
+ * @return One past the last byte written
+ */
+inline uint8_t* encodeDiffColumn(const int64_t* vals, int count, uint8_t* out) {
+    std::vector<int64_t> resid(vals, vals + count);
+    int bestOrder = 0;
+    long bestSize = LONG_MAX;
+    for (int kk = 0; kk <= COMPRESSED_EPHEM_MAX_ORDER && kk < count; kk++) {
+        if (kk > 0) diffColumn(&resid[0], count, kk-1, kk);
+        long size = 0;
+        for (int ii = 0; ii < count; ii++) size += varintSize(resid[ii]);
+        if (size < bestSize) {
+            bestSize = size;
+            bestOrder = kk;
+        }
+    }
+
+    resid.assign(vals, vals + count);
+    diffColumn(&resid[0], count, 0, bestOrder);
+    *out++ = (uint8_t)bestOrder;
+    for (int ii = 0; ii < count; ii++) out = putVarint(out, resid[ii]);
+    return out;
+}
+
+/**
+ * Decodes a column written by encodeDiffColumn
+ *
+ * Runs the differencing backwards, keeping the latest difference of every
+ * order below the column's.
+ *
+ * @param Start of the column
+ * @param End of the buffer
+ * @param Number of values
+ * @param Output values
+ *
+ * @return One past the column, or NULL if it is corrupt
+ */
+inline const uint8_t* decodeDiffColumn(const uint8_t* pos, const uint8_t* end, int count, int64_t* vals) {
+    if (pos >= end) return NULL;
+    int order = *pos++;
+    if (order > COMPRESSED_EPHEM_MAX_ORDER) return NULL;
+
+    int64_t last[COMPRESSED_EPHEM_MAX_ORDER + 1];
+    for (int ii = 0; ii < count; ii++) {
+        int top = (ii < order) ? ii : order;
+        pos = getVarint(pos, end, &last[top]);
+        if (pos == NULL) return NULL;
+        for (int ll = top-1; ll >= 0; ll--) {
+            last[ll] += last[ll+1];
+        }
+        vals[ii] = last[0];
+    }
+    return pos;
+}
+
+/**
+ * Rounds a value to a whole number of quanta
+ */
+inline int64_t quantize(double val, double quantum) {
+    double qq = val/quantum;
+    if (!(fabs(qq) < COMPRESSED_EPHEM_MAX_QUANTA)) throw "Ephemeris value out of range for compression quantum";
+    return llround(qq);
+}
+
+/**
+ * Codes one block of an ephemeris
+ *
+ * @param Ephemeris to code
+ * @param First sample of the block
+ * @param One past the last sample of the block
+ * @param Codec settings
+ * @param Time of tick zero
+ * @param Output bytes
+ */
+inline void encodeEphemBlock(const Ephemeris& ephem, int begin, int end, const EphemCodecOptions& options, Timecode epoch, std::vector<uint8_t>& out) {
+    const std::vector<StateVec>& states = ephem.states_;
+    int count = end - begin;
+    int ncols = ephem.accValid_ ? 10 : 7;
+    out.resize(ncols*(1 + 10*(size_t)count));
+
+    std::vector<int64_t> vals(count);
+    uint8_t* pos = &out[0];
+    for (int cc = 0; cc < ncols; cc++) {
+        for (int ii = 0; ii < count; ii++) {
+            const StateVec& sv = states[begin + ii];
+            if (cc == 0) {
+                vals[ii] = quantize(sv.tc_ - epoch, 1.0/options.ticksPerSecond_);
+            } else if (cc < 4) {
+                vals[ii] = quantize(sv.pos_[cc-1], options.posQuantum_);
+            } else if (cc < 7) {
+                vals[ii] = quantize(sv.vel_[cc-4], options.velQuantum_);
+            } else {
+                vals[ii] = quantize(sv.acc_[cc-7], options.accQuantum_);
+            }
+        }
+        pos = encodeDiffColumn(&vals[0], count, pos);
+    }
+    out.resize(pos - &out[0]);
+}
+
+/**
+ * Writes an ephemeris to a compressed ephemeris file
+ *
+ * Samples are quantized as set by the options, see EphemCodecOptions for the
+ * error bound, and coded in independent blocks so readers can decode just
+ * the blocks they need. Blocks are coded concurrently and written in order,
+ * so the file doesn't depend on the number of threads.
+ *
+ * @param File to write
+ * @param Ephemeris to write
+ * @param Quanta and block size
+ * @param Number of threads, zero or less for one per hardware thread
+ *
+ * @return True if the file was written, throws if a value can't be quantized
+ */
+inline bool writeEphemCompressed(std::string outfile, const Ephemeris& ephem, const EphemCodecOptions& options = EphemCodecOptions(), int nthreads = 1) {
+    if (!(options.posQuantum_ > 0 && options.velQuantum_ > 0 && options.accQuantum_ > 0)) {
+        throw "Compression quanta must be positive";
+    }
+    if (options.blockSize_ < 1 || options.blockSize_ > (1 << 20)) throw "Unsupported compression block size";
+    if (options.ticksPerSecond_ < 1 || options.ticksPerSecond_ > 1000000000000LL) throw "Unsupported ticks per second";
+
+    const std::vector<StateVec>& states = ephem.states_;
+    int count = states.size();
+    int numBlocks = (count + options.blockSize_ - 1)/options.blockSize_;
+    Timecode epoch = (count > 0) ? states[0].tc_ : Timecode();
+
+    CompressedEphemHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic_, COMPRESSED_EPHEM_MAGIC, sizeof(header.magic_));
+    header.version_ = COMPRESSED_EPHEM_VERSION;
+    header.byteOrder_ = BINARY_EPHEM_BYTE_ORDER;
+    header.headerSize_ = sizeof(header);
+    header.flags_ = ephem.accValid_ ? BINARY_EPHEM_ACC : 0;
+    header.csystem_ = ephem.csystem_;
+    header.interpMethod_ = ephem.interpMethod_;
+    header.csystemEpochWhole_ = ephem.csystemEpoch_.getWhole();
+    header.csystemEpochFract_ = ephem.csystemEpoch_.getFract();
+    header.epochWhole_ = epoch.getWhole();
+    header.epochFract_ = epoch.getFract();
+    header.count_ = count;
+    header.ticksPerSecond_ = options.ticksPerSecond_;
+    header.posQuantum_ = options.posQuantum_;
+    header.velQuantum_ = options.velQuantum_;
+    header.accQuantum_ = options.accQuantum_;
+    header.blockSize_ = options.blockSize_;
+    header.numBlocks_ = numBlocks;
+    header.lastTick_ = (count > 0) ? quantize(states[count-1].tc_ - epoch, 1.0/options.ticksPerSecond_) : 0;
+
+    std::vector<int64_t> firstTicks(numBlocks);
+    for (int ii = 0; ii < numBlocks; ii++) {
+        firstTicks[ii] = quantize(states[ii*options.blockSize_].tc_ - epoch, 1.0/options.ticksPerSecond_);
+    }
+
+    FILE* fp = fopen(outfile.c_str(), "wb");
+    if (fp == NULL) return false;
+    bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+
+    // Code a group of blocks at a time so memory use stays bounded. A value
+    // that can't be quantized only shows up here, so don't leave a partial file.
+    std::vector<uint64_t> index(1, sizeof(header));
+    const int group = 256;
+    std::vector<std::vector<uint8_t> > blocks(group);
+    try {
+        for (int first = 0; first < numBlocks && ok; first += group) {
+            int ngroup = std::min(group, numBlocks - first);
+            parallelFor(ngroup, nthreads, [&](long begin, long end) {
+                for (long ii = begin; ii < end; ii++) {
+                    int block = first + ii;
+                    int lo = block*options.blockSize_;
+                    int hi = std::min(count, lo + options.blockSize_);
+                    encodeEphemBlock(ephem, lo, hi, options, epoch, blocks[ii]);
+                }
+            });
+            for (int ii = 0; ii < ngroup && ok; ii++) {
+                ok = fwrite(&blocks[ii][0], 1, blocks[ii].size(), fp) == blocks[ii].size();
+                index.push_back(index.back() + blocks[ii].size());
+            }
+        }
+    } catch (...) {
+        fclose(fp);
+        remove(outfile.c_str());
+        throw;
+    }
+
+    // Index on an 8 byte boundary after the blocks, then the final header
+    if (ok) {
+        size_t pad = (8 - index.back() % 8) % 8;
+        char zeros[8] = {0};
+        header.indexOffset_ = index.back() + pad;
+        ok = fwrite(zeros, 1, pad, fp) == pad &&
+            fwrite(&index[0], sizeof(uint64_t), index.size(), fp) == index.size() &&
+            fwrite(firstTicks.data(), sizeof(int64_t), numBlocks, fp) == (size_t)numBlocks &&
+            fseek(fp, 0, SEEK_SET) == 0 &&
+            fwrite(&header, sizeof(header), 1, fp) == 1;
+    }
+
+    if (fclose(fp) != 0) ok = false;
+    return ok;
+}
+
+class CompressedEphemeris;
+int sampleLowerBound(const CompressedEphemeris& src, Timecode tc);
+
+/**
+ * Read only ephemeris backed by a memory mapped compressed ephemeris file
+ *
+ * Opening a file only maps it and checks the header and index. Blocks are
+ * decoded when a state in them is first needed and the last few are kept,
+ * so a Cursor sweeping forward decodes each block once. Searches for a time
+ * go through the first sample times in the index, so a random query decodes
+ * the block holding its time, plus the next one when the interpolation
+ * window runs over the end of the block. Interpolation runs the same SampleCursor as
+ * Ephemeris, so results are identical to decoding the whole file into an
+ * Ephemeris with toEphemeris and interpolating that.
+ *
+ * The decoded block cache makes queries unsafe to run from several threads
+ * on one object. Opening is cheap, so give each thread its own.
+ */
+class CompressedEphemeris {
+    public:
+        /**
+         * Maps a compressed ephemeris file, throwing if it is not one or is truncated
+         *
+         * @param File to map
+         */
+        CompressedEphemeris(std::string filename) : file_(filename) {
+            file_.advise(MADV_RANDOM);
+
+            CompressedEphemHeader header;
+            if (file_.size() < sizeof(header)) throw "Not a compressed ephemeris file";
+            memcpy(&header, file_.data(), sizeof(header));
+            if (memcmp(header.magic_, COMPRESSED_EPHEM_MAGIC, sizeof(header.magic_)) != 0) {
+                throw "Not a compressed ephemeris file";
+            }
+            if (header.byteOrder_ != BINARY_EPHEM_BYTE_ORDER) throw "Compressed ephemeris has a different byte order";
+            if (header.version_ != COMPRESSED_EPHEM_VERSION) throw "Unsupported compressed ephemeris version";
+            if (header.count_ < 0 || header.count_ > INT_MAX || header.blockSize_ < 1 || header.ticksPerSecond_ < 1 ||
+                header.numBlocks_ != (header.count_ + header.blockSize_ - 1)/header.blockSize_) {
+                throw "Invalid compressed ephemeris size";
+            }
+            if (header.interpMethod_ < LAGRANGE || header.interpMethod_ > HERMITE) {
+                throw "Unknown interpolation method in compressed ephemeris";
+            }
+            if (header.csystem_ < FIXED || header.csystem_ > J2000) throw "Unknown coordinate system in compressed ephemeris";
+            uint64_t indexSize = (header.numBlocks_ + 1)*sizeof(uint64_t) + header.numBlocks_*sizeof(int64_t);
+            if (header.indexOffset_ % 8 != 0 || header.indexOffset_ > file_.size() ||
+                indexSize > file_.size() - header.indexOffset_) {
+                throw "Truncated compressed ephemeris file";
+            }
+
+            count_ = header.count_;
+            numBlocks_ = header.numBlocks_;
+            index_ = (const uint64_t*)(file_.data() + header.indexOffset_);
+            firstTicks_ = (const int64_t*)(index_ + numBlocks_ + 1);
+            end_ = header.indexOffset_;
+            epochWhole_ = header.epochWhole_;
+            epochFract_ = header.epochFract_;
+            accValid_ = (header.flags_ & BINARY_EPHEM_ACC) != 0;
+            interpMethod_ = (InterpMethod)header.interpMethod_;
+            csystem_ = (CoordSystem)header.csystem_;
+            csystemEpoch_ = Timecode(header.csystemEpochWhole_, header.csystemEpochFract_);
+            options_ = EphemCodecOptions(
+                header.posQuantum_, header.velQuantum_, header.accQuantum_,
+                header.blockSize_, header.ticksPerSecond_
+            );
+            last_ = tickTime(header.lastTick_);
+
+            for (int ii = 0; ii < NUM_CACHED; ii++) cacheBlock_[ii] = -1;
+            cacheNext_ = 0;
+            decoded_ = 0;
+        }
+
+        typedef SampleCursor<CompressedEphemeris> Cursor;
+
+        /**
+         * Gets the number of samples
+         */
+        int numStates() const {
+            return count_;
+        }
+
+        /**
+         * Gets the number of independently coded blocks
+         */
+        int numBlocks() const {
+            return numBlocks_;
+        }
+
+        /**
+         * Gets the time of a sample
+         */
+        Timecode stateTime(int idx) const {
+            // Searches check the ends of the span and of blocks on every query
+            if (idx == count_-1) return last_;
+            if (idx % options_.blockSize_ == 0) return tickTime(firstTicks_[idx/options_.blockSize_]);
+            return cachedBlock(idx/options_.blockSize_)[idx % options_.blockSize_].tc_;
+        }
+
+        /**
+         * Finds the first sample at or after a time
+         *
+         * Blocks are searched by their first sample times from the index, so
+         * only the block holding the answer is decoded.
+         *
+         * @param Time to look for
+         *
+         * @return Index of the first sample not before the time, or
+         *         numStates() if every sample is before it
+         */
+        int lowerBound(Timecode tc) const {
+            int lo = 0, hi = numBlocks_;
+            while (lo < hi) {
+                int mid = lo + (hi - lo)/2;
+                if (tickTime(firstTicks_[mid]) < tc) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            if (lo == 0) return 0;
+
+            // The answer is past the first sample of block lo-1 and at or
+            // before the first sample of block lo
+            int block = lo - 1;
+            int begin = block*options_.blockSize_;
+            int count = std::min(options_.blockSize_, count_ - begin);
+            const StateVec* states = cachedBlock(block);
+            lo = 1;
+            hi = count;
+            while (lo < hi) {
+                int mid = lo + (hi - lo)/2;
+                if (states[mid].tc_ < tc) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            return begin + lo;
+        }
+
+        /**
+         * Gets the number of blocks decoded into the cache so far
+         */
+        long blocksDecoded() const {
+            return decoded_;
+        }
+
+        /**
+         * Gets a sample
+         */
+        StateVec getState(int idx) const {
+            return cachedBlock(idx/options_.blockSize_)[idx % options_.blockSize_];
+        }
+
+        /**
+         * Interpolates the ephemeris to the given time using the ephemeris
+         * interpolation method
+         *
+         * For many queries at increasing times use a Cursor instead.
+         *
+         * @param Time to interpolate to
+         * @param Number of points to use in interpolation
+         *
+         * @return The interpolated state at the given time
+         */
+        StateVec getSV(Timecode tc, int numpts = 4) const {
+            Cursor cursor(*this);
+            return cursor.getSV(tc, numpts);
+        }
+
+        /**
+         * Decodes one block without touching the cache, so any number of
+         * threads can decode blocks at once
+         *
+         * @param Block to decode
+         * @param Output buffer with room for a block of states
+         *
+         * @return Number of states in the block
+         */
+        int decodeBlock(int block, StateVec* out) const {
+            if (block < 0 || block >= numBlocks_) throw "Compressed ephemeris block out of range";
+            int count = std::min(options_.blockSize_, count_ - block*options_.blockSize_);
+            if (index_[block] > index_[block+1] || index_[block+1] > end_) throw "Corrupt compressed ephemeris block";
+            const uint8_t* pos = (const uint8_t*)file_.data() + index_[block];
+            const uint8_t* end = (const uint8_t*)file_.data() + index_[block+1];
+
+            std::vector<int64_t> vals(count);
+            int ncols = accValid_ ? 10 : 7;
+            for (int cc = 0; cc < ncols; cc++) {
+                pos = decodeDiffColumn(pos, end, count, &vals[0]);
+                if (pos == NULL) throw "Corrupt compressed ephemeris block";
+                for (int ii = 0; ii < count; ii++) {
+                    if (cc == 0) {
+                        out[ii].tc_ = tickTime(vals[ii]);
+                    } else if (cc < 4) {
+                        out[ii].pos_[cc-1] = vals[ii]*options_.posQuantum_;
+                    } else if (cc < 7) {
+                        out[ii].vel_[cc-4] = vals[ii]*options_.velQuantum_;
+                    } else {
+                        out[ii].acc_[cc-7] = vals[ii]*options_.accQuantum_;
+                    }
+                }
+            }
+            return count;
+        }
+
+        /**
+         * Decodes every sample into an in memory ephemeris
+         *
+         * @param Number of threads, zero or less for one per hardware thread
+         *
+         * @return Ephemeris with the same samples and settings
+         */
+        Ephemeris toEphemeris(int nthreads = 1) const {
+            Ephemeris ephem;
+            ephem.accValid_ = accValid_;
+            ephem.interpMethod_ = interpMethod_;
+            ephem.csystem_ = csystem_;
+            ephem.csystemEpoch_ = csystemEpoch_;
+
+            std::vector<StateVec>& states = ephem.states_;
+            states.resize(count_);
+            parallelFor(numBlocks_, nthreads, [&](long begin, long end) {
+                for (long ii = begin; ii < end; ii++) {
+                    decodeBlock(ii, &states[ii*options_.blockSize_]);
+                }
+            });
+            return ephem;
+        }
+
+    private:
+        CompressedEphemeris(const CompressedEphemeris&);
+        CompressedEphemeris& operator=(const CompressedEphemeris&);
+
+        Timecode tickTime(int64_t tick) const {
+            int64_t tps = options_.ticksPerSecond_;
+            return Timecode(epochWhole_ + (int)(tick/tps), epochFract_ + (double)(tick % tps)/tps);
+        }
+
+        const StateVec* cachedBlock(int block) const {
+            for (int ii = 0; ii < NUM_CACHED; ii++) {
+                if (cacheBlock_[ii] == block) return &cache_[ii][0];
+            }
+
+            int slot = cacheNext_;
+            cacheNext_ = (cacheNext_ + 1) % NUM_CACHED;
+            cacheBlock_[slot] = -1;
+            cache_[slot].resize(options_.blockSize_);
+            decodeBlock(block, &cache_[slot][0]);
+            cacheBlock_[slot] = block;
+            decoded_++;
+            return &cache_[slot][0];
+        }
+
+    public:
+        bool accValid_;
+        InterpMethod interpMethod_;
+
+        CoordSystem csystem_;
+        Timecode csystemEpoch_;
+
+        EphemCodecOptions options_;
+
+    private:
+        static const int NUM_CACHED = 4;
+
+        MappedFile file_;
+        int count_, numBlocks_;
+        const uint64_t* index_;
+        const int64_t* firstTicks_;
+        uint64_t end_;
+        int epochWhole_;
+        double epochFract_;
+        Timecode last_;
+
+        mutable int cacheBlock_[NUM_CACHED];
+        mutable std::vector<StateVec> cache_[NUM_CACHED];
+        mutable int cacheNext_;
+        mutable long decoded_;
+};
+
+/**
+ * Finds the first sample of a compressed ephemeris at or after a time using
+ * its block index, see CompressedEphemeris::lowerBound
+ */
+inline int sampleLowerBound(const CompressedEphemeris& src, Timecode tc) {
+    return src.lowerBound(tc);
+}
+
+/**
+ * Checks whether a file is a compressed ephemeris file
+ *
+ * @param File to check
+ */
+inline bool isCompressedEphemFile(std::string filename) {
+    return hasFileMagic(filename, COMPRESSED_EPHEM_MAGIC);
+}
+
+/**
+ * Reads a binary, compressed or AGI ephemeris file, telling them apart by
+ * their contents
+ *
+ * @param File to read
+ * @param Number of threads, zero or less for one per hardware thread
+ *
+ * @return Ephemeris from file
+ */
+inline Ephemeris readEphemFile(std::string filename, int nthreads = 1) {
+    if (isBinaryEphemFile(filename)) return EphemerisView(filename).toEphemeris(nthreads);
+    if (isCompressedEphemFile(filename)) return CompressedEphemeris(filename).toEphemeris(nthreads);
+    return readEphemAGI(filename, nthreads);
+}
+
+#endif
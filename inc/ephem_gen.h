@@ -2,27 +2,44 @@
 #define ASTRO_EPHEM_GEN_H
 
 #include "sgp4.h"
+#include "sgp4_batch.h"
 #include "ephemeris.h"
+#include "parallel.h"
 
-Ephemeris ephemFromTLE(TLE tle, Timecode tc0, Timecode tc1, double dt) {
+/**
+ * Generates an ephemeris from a TLE at a fixed time step
+ *
+ * The last point is always at tc1. With more than one thread the output times
+ * are split into contiguous ranges and each worker propagates its range with
+ * its own propagation context, giving the same states as a single thread. Near
+ * earth TLE's are propagated several times at once with propagateNearTimes.
+ *
+ * @param TLE to propagate
+ * @param Start time
+ * @param Stop time
+ * @param Time step in seconds
+ * @param Number of threads, zero or less for one per hardware thread
+ *
+ * @return Generated ephemeris
+ */
+Ephemeris ephemFromTLE(const TLE& tle, Timecode tc0, Timecode tc1, double dt, int nthreads = 1) {
     Ephemeris ephem;
     ephem.csystem_ = TEME;
     ephem.csystemEpoch_ = tle.epoch_;
 
-    int count = 0;
-    Timecode tc = tc0;
-    while (tc <= tc1) {
-        ephem.states_.push_back(tle.getState(tc));
-        count++;
-
-        // Ensure last point is created
-        Timecode next = tc0 + count*dt;
-        if (tc < tc1 && next > tc1) {
-            tc = tc1;
-        } else {
-            tc = next;
+    StepGrid grid(tc0, tc1, dt);
+    ephem.states_.resize(grid.size());
+    std::vector<StateVec>& states = ephem.states_;
+    parallelFor(grid.size(), nthreads, [&](long begin, long end) {
+        if (tle.satrec_.method != 'd') {
+            propagateNearTimes(tle, grid, begin, end, &states[0]);
+            return;
+        }
+        Sgp4Context context;
+        for (long ii = begin; ii < end; ii++) {
+            states[ii] = tle.getState(grid[ii], context);
         }
-    }
+    });
 
     return ephem;
 }
@@ -1,11 +1,11 @@
 #ifndef ASTRO_EPHEMERIS_H
 #define ASTRO_EPHEMERIS_H
 
-#include <set>
 #include <algorithm>
 
 #include "statevec.h"
 #include "interpolate.h"
+#include "parallel.h"
 
 enum CoordSystem {
     FIXED = 0,
@@ -14,11 +14,253 @@ enum CoordSystem {
     J2000
 };
 
+enum InterpMethod {
+    LAGRANGE = 0,
+    HERMITE
+};
+
+/**
+ * Gets the index of the first sample at or after the given time
+ *
+ * @param Sampled ephemeris with numStates() and stateTime(idx)
+ * @param Time to search for
+ *
+ * @return Index of first sample not before tc, or the number of samples if none
+ */
+template <class Source>
+int sampleLowerBound(const Source& src, Timecode tc) {
+    int nn = src.numStates();
+
+    // Guess the index assuming uniform spacing and keep it if it checks out
+    double span = src.stateTime(nn-1) - src.stateTime(0);
+    if (span > 0) {
+        double guess = ceil((tc - src.stateTime(0))/span*(nn-1));
+        static const int offsets[] = {0, -1, 1};
+        for (int ii = 0; ii < 3; ii++) {
+            double cand = guess + offsets[ii];
+            if (cand < 0 || cand > nn) continue;
+
+            int idx = (int)cand;
+            if ((idx == 0 || src.stateTime(idx-1) < tc) &&
+                (idx == nn || !(src.stateTime(idx) < tc))) {
+                return idx;
+            }
+        }
+    }
+
+    int lo = 0, hi = nn;
+    while (lo < hi) {
+        int mid = lo + (hi - lo)/2;
+        if (src.stateTime(mid) < tc) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/**
+ * Finds the lower index of the sample interval bounding the given time
+ *
+ * See Ephemeris::bracket.
+ *
+ * @param Sampled ephemeris with numStates() and stateTime(idx)
+ * @param Time to find the bounding interval for
+ * @param Index returned by a previous call, or -1 if there is none
+ *
+ * @return Lower index of the bounding interval
+ */
+template <class Source>
+int sampleBracket(const Source& src, Timecode tc, int hint) {
+    int nn = src.numStates();
+    if (nn < 2) throw "Requested time outside ephemeris time span";
+
+    int idx;
+    if (hint >= 0 && hint < nn && src.stateTime(hint) < tc) {
+        idx = hint + 1;
+        while (idx < nn && src.stateTime(idx) < tc) idx++;
+        idx--;
+    } else {
+        idx = sampleLowerBound(src, tc) - 1;
+    }
+
+    if (idx < 0) idx = 0;
+    if (idx > nn-2) idx = nn-2;
+    return idx;
+}
+
+/**
+ * Gets the range of samples to interpolate over for the given interval
+ *
+ * @param Number of samples
+ * @param Lower index of the bounding interval
+ * @param Number of points to use in interpolation
+ * @param Output index of the first sample in the window
+ * @param Output index of the last sample in the window
+ */
+inline void sampleWindow(int nn, int idx, int numpts, int& idx_lo, int& idx_hi) {
+    // XXX Handle odd number of points better
+    idx_lo = idx - floor(numpts/2.0) + 1;
+    idx_hi = idx + floor(numpts/2.0);
+    if (idx_lo < 0) idx_lo = 0;
+    if (idx_hi > nn-1) idx_hi = nn-1;
+
+    // XXX Handle edge cases
+    int tmp_numpts = idx_hi - idx_lo + 1;
+    if (tmp_numpts != numpts) {
+        if (idx_lo == 0) idx_hi += numpts - tmp_numpts;
+        if (idx_hi == nn-1) idx_lo -= numpts - tmp_numpts;
+    }
+    if (idx_lo < 0) idx_lo = 0;
+    if (idx_hi > nn-1) idx_hi = nn-1;
+}
+
+/**
+ * Stateful interpolator for a sequence of queries into a sampled ephemeris
+ *
+ * Remembers the last bracketing interval and the interpolation table of
+ * the last window, so queries at increasing times only
+ * search forward from the previous one and reuse the interpolation
+ * table while they stay within the same window. Queries that go back in
+ * time still work, they just fall back to a full search.
+ *
+ * The source provides numStates(), stateTime(idx), getState(idx) and the
+ * accValid_ and interpMethod_ members, so the same code interpolates an
+ * Ephemeris in memory and a mapped EphemerisView. A source with a cheaper
+ * search than bisecting stateTime can overload sampleLowerBound for its type.
+ * The source must outlive the cursor and must not be modified while the
+ * cursor is in use.
+ *
+ * @tparam Sampled ephemeris type
+ */
+template <class Source>
+class SampleCursor {
+    public:
+        SampleCursor(const Source& src) : src_(src) {
+            reset();
+        }
+
+        /**
+         * Forgets the cached bracket and interpolation window
+         */
+        void reset() {
+            idx_ = -1;
+            idx_lo_ = -1;
+            numpts_ = 0;
+            method_ = LAGRANGE;
+        }
+
+        /**
+         * Interpolates the ephemeris to the given time using the
+         * ephemeris interpolation method
+         *
+         * @param Time to interpolate to
+         * @param Number of points to use in interpolation
+         *
+         * @return The interpolated state at the given time
+         */
+        StateVec getSV(Timecode tc, int numpts = 4) {
+            if (src_.numStates() == 0) throw "No ephemeris points to interpolate";
+
+            // Find bounding indices
+            idx_ = sampleBracket(src_, tc, idx_);
+            if (src_.stateTime(idx_) == tc) return src_.getState(idx_);
+            if (src_.stateTime(idx_+1) == tc) return src_.getState(idx_+1);
+            if (!(src_.stateTime(idx_) <= tc && src_.stateTime(idx_+1) >= tc)) {
+                throw "Requested time outside ephemeris time span";
+            }
+
+            // Rebuild the interpolation table only when the window moves
+            int idx_lo, idx_hi;
+            sampleWindow(src_.numStates(), idx_, numpts, idx_lo, idx_hi);
+            InterpMethod method = src_.interpMethod_;
+            if (idx_lo != idx_lo_ || numpts != numpts_ || method != method_) {
+                if (method == HERMITE) {
+                    buildHermite(idx_lo, idx_hi);
+                } else {
+                    buildTable(idx_lo, idx_hi);
+                }
+                idx_lo_ = idx_lo;
+                numpts_ = numpts;
+                method_ = method;
+            }
+
+            StateVec ans;
+            ans.tc_ = tc;
+            if (method == HERMITE) {
+                double pos[3], vel[3], acc[3];
+                hermite_.eval(tc - src_.stateTime(0), pos, vel, acc);
+                ans.pos_ = Vec3(pos[0], pos[1], pos[2]);
+                ans.vel_ = Vec3(vel[0], vel[1], vel[2]);
+                if (src_.accValid_) ans.acc_ = Vec3(acc[0], acc[1], acc[2]);
+            } else {
+                double vals[9] = {0};
+                table_.eval(tc - src_.stateTime(0), vals);
+                ans.pos_ = Vec3(vals[0], vals[1], vals[2]);
+                ans.vel_ = Vec3(vals[3], vals[4], vals[5]);
+                if (table_.numfuncs_ == 9) ans.acc_ = Vec3(vals[6], vals[7], vals[8]);
+            }
+
+            return ans;
+        }
+
+    private:
+        void buildHermite(int idx_lo, int idx_hi) {
+            Timecode tc0 = src_.stateTime(0);
+
+            // Position with velocity (and acceleration) as its derivatives
+            hermite_.resize(idx_hi - idx_lo + 1, 3, src_.accValid_ ? 3 : 2);
+            for (int jj = 0; jj < hermite_.numpts_; jj++) {
+                const StateVec& sv = src_.getState(idx_lo + jj);
+                hermite_.xx(jj) = sv.tc_ - tc0;
+                for (int kk = 0; kk < 3; kk++) {
+                    hermite_.fx(kk, jj, 0) = sv.pos_[kk];
+                    hermite_.fx(kk, jj, 1) = sv.vel_[kk];
+                    if (src_.accValid_) hermite_.fx(kk, jj, 2) = sv.acc_[kk];
+                }
+            }
+            hermite_.build();
+        }
+
+        void buildTable(int idx_lo, int idx_hi) {
+            Timecode tc0 = src_.stateTime(0);
+
+            // Interpolate all elements together over the shared times
+            table_.resize(idx_hi - idx_lo + 1, src_.accValid_ ? 9 : 6);
+            for (int jj = 0; jj < table_.numpts_; jj++) {
+                const StateVec& sv = src_.getState(idx_lo + jj);
+                table_.xx(jj) = sv.tc_ - tc0;
+                table_.fx(0, jj) = sv.pos_.x_;
+                table_.fx(1, jj) = sv.pos_.y_;
+                table_.fx(2, jj) = sv.pos_.z_;
+                table_.fx(3, jj) = sv.vel_.x_;
+                table_.fx(4, jj) = sv.vel_.y_;
+                table_.fx(5, jj) = sv.vel_.z_;
+                if (table_.numfuncs_ == 9) {
+                    table_.fx(6, jj) = sv.acc_.x_;
+                    table_.fx(7, jj) = sv.acc_.y_;
+                    table_.fx(8, jj) = sv.acc_.z_;
+                }
+            }
+            table_.build();
+        }
+
+    private:
+        const Source& src_;
+        int idx_;
+        int idx_lo_, numpts_;
+        InterpMethod method_;
+        LagrangeTable<MAX_INTERP_PTS, 9> table_;
+        HermiteTable<MAX_INTERP_PTS, 3> hermite_;
+};
+
 class Ephemeris {
     public:
         Ephemeris() {
             csystem_ = FIXED;
             accValid_ = false;    
+            interpMethod_ = LAGRANGE;
         }
 
         /**
@@ -26,130 +268,247 @@ class Ephemeris {
          *
          * @return The number of elements in each state vec
          */
-        int stateVecSize() {
+        int stateVecSize() const {
             if (accValid_) return 9;
             return 6;
         }
 
         /**
-         * Interpolates the ephemeris to the given time using lagrange interpolation
+         * Stateful interpolator over this ephemeris, see SampleCursor
+         */
+        typedef SampleCursor<Ephemeris> Cursor;
+
+        /**
+         * Interpolates the ephemeris to the given time using the ephemeris
+         * interpolation method
+         *
+         * Lagrange interpolation treats every state element independently.
+         * Hermite interpolation fits position to the sampled position and
+         * velocity (and acceleration when valid) and takes velocity from the
+         * derivative of that fit, so it needs far fewer samples for the same
+         * accuracy.
+         *
+         * For many queries at increasing times use a Cursor instead, which
+         * avoids repeating the search and table setup on every call.
          *
          * @param Time to interpolate to
          * @param Number of points to use in interpolate
          *
          * @return The interpolated state at the given time
          */
-        StateVec getSV(Timecode tc, int numpts = 4) {
-            if (states_.size() == 0) throw "No ephemeris points to interpolate";
+        StateVec getSV(Timecode tc, int numpts = 4) const {
+            Cursor cursor(*this);
+            return cursor.getSV(tc, numpts);
+        }
 
-            // Find bounding indices
-            int idx = 0;
-            bool found = false;
-            while (idx < (int)states_.size()-1) {
-                if (states_[idx].tc_ == tc) return states_[idx];
-                if (states_[idx+1].tc_ == tc) return states_[idx+1];
-
-                if (states_[idx].tc_ <= tc && states_[idx+1].tc_ >= tc) {
-                    found = true;
-                    break;
-                }
-                idx++;
-            }
-            if (!found) throw "Requested time outside ephemeris time span";
-
-            // XXX Handle odd number of points better
-            int idx_lo = idx - floor(numpts/2.0) + 1;
-            int idx_hi = idx + floor(numpts/2.0);
-            if (idx_lo < 0) idx_lo = 0;
-            if (idx_hi > (int)states_.size()-1) idx_hi = states_.size()-1;
-
-            // XXX Handle edge cases
-            int tmp_numpts = idx_hi - idx_lo + 1;
-            if (tmp_numpts != numpts) {
-                if (idx_lo == 0) idx_hi += numpts - tmp_numpts;
-                if (idx_hi == (int)states_.size()-1) idx_lo -= numpts - tmp_numpts;
+        /**
+         * Interpolates the ephemeris to each of a list of times
+         *
+         * Times should be in increasing order. They are then merged against the
+         * sample times in a single forward pass and the interpolation table is
+         * reused across consecutive times in the same window. Unsorted times
+         * still give correct results, just without the single pass.
+         *
+         * @param Times to interpolate to
+         * @param Number of times
+         * @param Output buffer with room for one state per time
+         * @param Number of points to use in interpolation
+         */
+        void getSVs(const Timecode* tcs, size_t count, StateVec* out, int numpts = 4) const {
+            Cursor cursor(*this);
+            for (size_t ii = 0; ii < count; ii++) {
+                out[ii] = cursor.getSV(tcs[ii], numpts);
             }
-            
-            StateVec ans;
-            ans.tc_ = tc;
-            // Interpolate all elements individually
-            for (int ii = 0; ii < stateVecSize(); ii++) {
-                std::vector<double> fx;
-                std::vector<double> xx;
-                for (int jj = idx_lo; jj <= idx_hi; jj++) {
-                    xx.push_back(states_[jj].tc_ - states_[0].tc_);
-                    fx.push_back(states_[jj][ii]);
-                }
+        }
 
-                ans[ii] = evalInterp(divDiff(fx, xx), xx, tc - states_[0].tc_);
+        /**
+         * Interpolates the ephemeris to each of a list of times
+         *
+         * @param Times to interpolate to, preferably in increasing order
+         * @param Output states, resized to match the number of times
+         * @param Number of points to use in interpolation
+         */
+        void getSVs(const std::vector<Timecode>& tcs, std::vector<StateVec>& out, int numpts = 4) const {
+            out.resize(tcs.size());
+            if (tcs.size() == 0) return;
+            getSVs(&tcs[0], tcs.size(), &out[0], numpts);
+        }
+
+        /**
+         * Interpolates the current ephemeris to the given timestep, handing
+         * each state to a callback instead of storing it
+         *
+         * States are produced in time order and memory use does not depend on
+         * the number of output states, so resampling straight to a file or
+         * other sink runs in constant memory.
+         *
+         * @param time step to interpolate to
+         * @param callable taking a const StateVec&, called once per state
+         * @param number of points to use in interpolation
+         */
+        template <class Callback>
+        void streamToStep(double step, Callback callback, int numpts = 4) const {
+            if (states_.size() == 0) throw "No ephemeris points to interpolate";
+
+            Cursor cursor(*this);
+            StepGrid grid(states_.front().tc_, states_.back().tc_, step);
+            for (long ii = 0; ii < grid.size(); ii++) {
+                callback(cursor.getSV(grid[ii], numpts));
             }
-            
-            return ans;
         }
 
         /**
-         * Interpolates the current ephemeris to the given timestep using
-         * lagrange interpolation
+         * Interpolates the current ephemeris to the given timestep using the
+         * ephemeris interpolation method
          *  
+         * With more than one thread the output times are split into contiguous
+         * ranges, each worker interpolates its range with its own cursor, and
+         * the results are identical to the single threaded ones.
+         *
          * @param time step to interpolate to
          * @param number of points to use in interpolation
+         * @param number of threads, zero or less for one per hardware thread
          *
          * @return Ephemeris interpolated to given time step
          */
-        Ephemeris interpToStep(double step, int numpts = 4) {
+        Ephemeris interpToStep(double step, int numpts = 4, int nthreads = 1) const {
             Ephemeris ephem;
             ephem.accValid_ = accValid_;
+            ephem.interpMethod_ = interpMethod_;
             ephem.csystem_ = csystem_;
             ephem.csystemEpoch_ = csystemEpoch_;
 
-            int count = 0;
-            Timecode tc0 = states_.front().tc_;
-            Timecode tc1 = states_.back().tc_;
-            Timecode tc = tc0;
-            while (tc <= tc1) {
-                ephem.states_.push_back(getSV(tc, numpts));
-
-                count++;
-                Timecode next = tc0 + count*step;
-                if (tc < tc1 && next > tc1) {
-                    tc = tc1;
-                } else {
-                    tc = next;
+            std::vector<StateVec>& states = ephem.states_;
+            if (numWorkers(nthreads) == 1) {
+                if (states_.size() > 0) {
+                    states.reserve(StepGrid(states_.front().tc_, states_.back().tc_, step).size());
                 }
+                streamToStep(step, [&states](const StateVec& sv) {
+                    states.push_back(sv);
+                }, numpts);
+                return ephem;
             }
+
+            if (states_.size() == 0) throw "No ephemeris points to interpolate";
+            StepGrid grid(states_.front().tc_, states_.back().tc_, step);
+            states.resize(grid.size());
+            parallelFor(grid.size(), nthreads, [&](long begin, long end) {
+                Cursor cursor(*this);
+                for (long ii = begin; ii < end; ii++) {
+                    states[ii] = cursor.getSV(grid[ii], numpts);
+                }
+            });
             return ephem;
         }
 
-        std::vector<StateVec> RIC(Ephemeris& ephem) {
+        /**
+         * Computes the RIC difference of another ephemeris relative to this one
+         *
+         * Differences are taken at every sample time of either ephemeris within
+         * their overlapping time span, interpolating whichever one has no
+         * sample at that time. Both sample lists are already in time order, so
+         * they are merged in a single pass with a cursor on each ephemeris and
+         * the output comes out sorted.
+         *
+         * @param Ephemeris to difference against this one
+         *
+         * @return RIC position and velocity differences in time order
+         */
+        std::vector<StateVec> RIC(const Ephemeris& ephem) const {
+            std::vector<StateVec> ans;
+            if (states_.size() == 0 || ephem.states_.size() == 0) return ans;
+
             Timecode tc0 = states_.front().tc_;
             Timecode tc1 = states_.back().tc_;
             if (ephem.states_.front().tc_ > tc0) tc0 = ephem.states_.front().tc_;
             if (ephem.states_.back().tc_ < tc1) tc1 = ephem.states_.back().tc_;
+            if (tc0 > tc1 && tc0 != tc1) return ans;
 
-            std::vector<StateVec> ans;
-            std::set<Timecode> times;
-            for (int ii = 0; ii < (int)states_.size(); ii++) {
-                times.insert(states_[ii].tc_);
-                StateVec other = ephem.getSV(states_[ii].tc_);
-                ans.push_back(states_[ii].ricDelta(other));
-            }
+            // Skip samples before the overlap, times within tolerance of tc0 count
+            int ii = 0, jj = 0;
+            int nn = states_.size(), mm = ephem.states_.size();
+            while (ii < nn && states_[ii].tc_ < tc0 && states_[ii].tc_ != tc0) ii++;
+            while (jj < mm && ephem.states_[jj].tc_ < tc0 && ephem.states_[jj].tc_ != tc0) jj++;
 
-            for (int ii = 0; ii < (int)ephem.states_.size(); ii++) {
-                if (times.count(ephem.states_[ii].tc_) == 1) continue;
-                
-                times.insert(ephem.states_[ii].tc_);
-                StateVec ref = getSV(ephem.states_[ii].tc_);
-                ans.push_back(ref.ricDelta(ephem.states_[ii]));
-            }
+            Cursor refCursor(*this);
+            Cursor otherCursor(ephem);
+            ans.reserve((nn - ii) + (mm - jj));
+            while (true) {
+                bool refDone = ii >= nn || (states_[ii].tc_ > tc1 && states_[ii].tc_ != tc1);
+                bool otherDone = jj >= mm || (ephem.states_[jj].tc_ > tc1 && ephem.states_[jj].tc_ != tc1);
+                if (refDone && otherDone) break;
 
-            std::sort(ans.begin(), ans.end());
+                if (!refDone && !otherDone && states_[ii].tc_ == ephem.states_[jj].tc_) {
+                    StateVec ref = states_[ii++];
+                    ans.push_back(ref.ricDelta(ephem.states_[jj++]));
+                } else if (otherDone || (!refDone && states_[ii].tc_ < ephem.states_[jj].tc_)) {
+                    StateVec ref = states_[ii++];
+                    ans.push_back(ref.ricDelta(otherCursor.getSV(ref.tc_)));
+                } else {
+                    StateVec ref = refCursor.getSV(ephem.states_[jj].tc_);
+                    ans.push_back(ref.ricDelta(ephem.states_[jj++]));
+                }
+            }
 
             return ans;
         }
 
+        /**
+         * Finds the lower index of the sample interval bounding the given time,
+         * such that states_[idx] <= tc <= states_[idx+1] when tc is in span
+         *
+         * With a hint from a previous query at an earlier time the search walks
+         * forward from there. Otherwise uniformly spaced ephemerides resolve in
+         * constant time and anything else falls back to a binary search. The
+         * result is clamped to a valid interval, so callers must still check
+         * that tc is actually bounded.
+         *
+         * @param Time to find the bounding interval for
+         * @param Index returned by a previous call, or -1 if there is none
+         *
+         * @return Lower index of the bounding interval
+         */
+        int bracket(Timecode tc, int hint = -1) const {
+            return sampleBracket(*this, tc, hint);
+        }
+
+        /**
+         * Gets the range of samples to interpolate over for the given interval
+         *
+         * @param Lower index of the bounding interval
+         * @param Number of points to use in interpolation
+         * @param Output index of the first sample in the window
+         * @param Output index of the last sample in the window
+         */
+        void interpWindow(int idx, int numpts, int& idx_lo, int& idx_hi) const {
+            sampleWindow(states_.size(), idx, numpts, idx_lo, idx_hi);
+        }
+
+        /**
+         * Gets the number of samples
+         */
+        int numStates() const {
+            return states_.size();
+        }
+
+        /**
+         * Gets the time of a sample
+         */
+        const Timecode& stateTime(int idx) const {
+            return states_[idx].tc_;
+        }
+
+        /**
+         * Gets a sample
+         */
+        const StateVec& getState(int idx) const {
+            return states_[idx];
+        }
+
     public:
         std::vector<StateVec> states_;
         bool accValid_;
+        InterpMethod interpMethod_;
 
         CoordSystem csystem_;
         Timecode csystemEpoch_;
@@ -3,11 +3,15 @@
 
 #include <iostream>
 #include <vector>
+#include <math.h>
+
+// Largest number of points supported by the fixed size interpolation kernels
+#define MAX_INTERP_PTS 16
 
 std::vector<double> divDiff(std::vector<double> fx, std::vector<double> xx) {
     for (int ii = 1; ii < (int)xx.size(); ii++) {
         for (int jj = xx.size()-1; jj >= ii; jj--) {
-            fx[jj] = (fx[jj] - fx[jj-1]) / (xx[jj] - xx[jj-1]);
+            fx[jj] = (fx[jj] - fx[jj-1]) / (xx[jj] - xx[jj-ii]);
         }
     }
 
@@ -24,4 +28,294 @@ double evalInterp(std::vector<double> ddiff, std::vector<double> xx, double tt)
     return ans;
 }
 
+/**
+ * Gets barycentric lagrange weights for equally spaced points
+ *
+ * For nodes 0, 1, ..., numpts-1 the weights are (-1)^j * C(numpts-1, j). They
+ * are computed once for every supported point count.
+ *
+ * @param Number of points
+ *
+ * @return Array of numpts weights
+ */
+const double* uniformBaryWeights(int numpts) {
+    struct Weights {
+        Weights() {
+            for (int nn = 1; nn <= MAX_INTERP_PTS; nn++) {
+                double binom = 1;
+                for (int jj = 0; jj < nn; jj++) {
+                    ww_[nn][jj] = (jj % 2 == 0) ? binom : -binom;
+                    binom = binom*(nn - 1 - jj)/(jj + 1);
+                }
+            }
+        }
+        double ww_[MAX_INTERP_PTS+1][MAX_INTERP_PTS];
+    };
+    static const Weights weights;
+
+    if (numpts < 1 || numpts > MAX_INTERP_PTS)
+        throw "Unsupported number of interpolation points";
+    return weights.ww_[numpts];
+}
+
+/**
+ * Lagrange interpolator for several functions sampled at the same abscissae
+ *
+ * Equally spaced abscissae are evaluated with precomputed barycentric weights,
+ * which reduces each evaluation to one weighted sum per function. Anything
+ * else uses Newton divided differences. Storage is fixed size so a table
+ * lives on the stack and building or evaluating it never allocates. Values
+ * are stored point-major so the inner loops run across functions.
+ *
+ * @tparam Maximum number of points per function
+ * @tparam Maximum number of functions
+ */
+template <int MAXPTS, int MAXFUNCS>
+class LagrangeTable {
+    public:
+        LagrangeTable() {
+            numpts_ = 0;
+            numfuncs_ = 0;
+            uniform_ = false;
+        }
+
+        /**
+         * Sets the number of points and functions the table will hold
+         *
+         * @param Number of points per function
+         * @param Number of functions
+         */
+        void resize(int numpts, int numfuncs) {
+            if (numpts < 1 || numpts > MAXPTS)
+                throw "Unsupported number of interpolation points";
+            if (numfuncs < 1 || numfuncs > MAXFUNCS)
+                throw "Unsupported number of interpolated functions";
+            numpts_ = numpts;
+            numfuncs_ = numfuncs;
+        }
+
+        /**
+         * Access to the sample abscissae, set before calling build()
+         */
+        double& xx(int pt) {
+            return xx_[pt];
+        }
+
+        /**
+         * Access to the sample values, set before calling build()
+         */
+        double& fx(int func, int pt) {
+            return dd_[pt][func];
+        }
+
+        /**
+         * Prepares the table for evaluation
+         *
+         * Checks whether the abscissae are equally spaced and, if they are
+         * not, replaces the sample values with their divided differences.
+         */
+        void build() {
+            uniform_ = numpts_ > 1;
+            step_ = (numpts_ > 1) ? (xx_[numpts_-1] - xx_[0])/(numpts_-1) : 0;
+            for (int ii = 1; ii < numpts_ && uniform_; ii++) {
+                double err = (xx_[ii] - xx_[0]) - ii*step_;
+                if (!(step_ > 0) || fabs(err) > 1e-9*step_) uniform_ = false;
+            }
+            if (uniform_) return;
+
+            for (int ii = 1; ii < numpts_; ii++) {
+                for (int jj = numpts_-1; jj >= ii; jj--) {
+                    double dx = xx_[jj] - xx_[jj-ii];
+                    for (int kk = 0; kk < numfuncs_; kk++) {
+                        dd_[jj][kk] = (dd_[jj][kk] - dd_[jj-1][kk]) / dx;
+                    }
+                }
+            }
+        }
+
+        /**
+         * Evaluates all interpolating polynomials at the given abscissa
+         *
+         * @param Abscissa to evaluate at
+         * @param Output array with one value per function
+         */
+        void eval(double tt, double* ans) const {
+            if (uniform_) {
+                evalUniform(tt, ans);
+                return;
+            }
+
+            int nn = numpts_-1;
+            for (int kk = 0; kk < numfuncs_; kk++) {
+                ans[kk] = dd_[nn][kk];
+            }
+            for (int ii = nn-1; ii >= 0; ii--) {
+                double dt = tt - xx_[ii];
+                for (int kk = 0; kk < numfuncs_; kk++) {
+                    ans[kk] = dd_[ii][kk] + dt*ans[kk];
+                }
+            }
+        }
+
+    private:
+        void evalUniform(double tt, double* ans) const {
+            const double* ww = uniformBaryWeights(numpts_);
+            double ss = (tt - xx_[0])/step_;
+
+            // Second barycentric form, weights normalized to sum to one
+            double cc[MAXPTS];
+            double sum = 0;
+            for (int jj = 0; jj < numpts_; jj++) {
+                double diff = ss - jj;
+                if (diff == 0) {
+                    for (int kk = 0; kk < numfuncs_; kk++) ans[kk] = dd_[jj][kk];
+                    return;
+                }
+                cc[jj] = ww[jj]/diff;
+                sum += cc[jj];
+            }
+
+            for (int kk = 0; kk < numfuncs_; kk++) {
+                ans[kk] = 0;
+            }
+            for (int jj = 0; jj < numpts_; jj++) {
+                double wj = cc[jj]/sum;
+                for (int kk = 0; kk < numfuncs_; kk++) {
+                    ans[kk] += wj*dd_[jj][kk];
+                }
+            }
+        }
+
+    public:
+        int numpts_, numfuncs_;
+        bool uniform_;
+        double step_;
+        double xx_[MAXPTS];
+        double dd_[MAXPTS][MAXFUNCS];
+};
+
+/**
+ * Hermite interpolator for several functions sampled at the same abscissae
+ * along with their first (and optionally second) derivatives
+ *
+ * Uses Newton divided differences over repeated nodes, so each sample point
+ * contributes one node per known derivative. Evaluation returns the value and
+ * the first two derivatives of the interpolating polynomial. Storage is fixed
+ * size like LagrangeTable.
+ *
+ * @tparam Maximum number of points per function
+ * @tparam Maximum number of functions
+ */
+template <int MAXPTS, int MAXFUNCS>
+class HermiteTable {
+    public:
+        HermiteTable() {
+            numpts_ = 0;
+            numfuncs_ = 0;
+            order_ = 0;
+            numnodes_ = 0;
+        }
+
+        /**
+         * Sets the number of points and functions the table will hold
+         *
+         * @param Number of points per function
+         * @param Number of functions
+         * @param Number of values known per point, 2 for value and first
+         *        derivative or 3 to include the second derivative
+         */
+        void resize(int numpts, int numfuncs, int order) {
+            if (numpts < 1 || numpts > MAXPTS)
+                throw "Unsupported number of interpolation points";
+            if (numfuncs < 1 || numfuncs > MAXFUNCS)
+                throw "Unsupported number of interpolated functions";
+            if (order < 2 || order > 3)
+                throw "Unsupported hermite interpolation order";
+            numpts_ = numpts;
+            numfuncs_ = numfuncs;
+            order_ = order;
+            numnodes_ = numpts*order;
+        }
+
+        /**
+         * Access to the sample abscissae, set before calling build()
+         */
+        double& xx(int pt) {
+            return xx_[pt];
+        }
+
+        /**
+         * Access to the sample values and derivatives, set before calling build()
+         *
+         * @param Function index
+         * @param Point index
+         * @param Derivative, 0 for the value itself
+         */
+        double& fx(int func, int pt, int deriv) {
+            return fx_[pt][deriv][func];
+        }
+
+        /**
+         * Computes the divided differences over the repeated nodes
+         */
+        void build() {
+            for (int ii = 0; ii < numnodes_; ii++) {
+                zz_[ii] = xx_[ii/order_];
+                for (int kk = 0; kk < numfuncs_; kk++) {
+                    dd_[ii][kk] = fx_[ii/order_][0][kk];
+                }
+            }
+
+            double fact = 1;
+            for (int ii = 1; ii < numnodes_; ii++) {
+                if (ii < order_) fact *= ii;
+                for (int jj = numnodes_-1; jj >= ii; jj--) {
+                    if (jj/order_ == (jj-ii)/order_) {
+                        // Repeated node, use the known derivative
+                        for (int kk = 0; kk < numfuncs_; kk++) {
+                            dd_[jj][kk] = fx_[jj/order_][ii][kk]/fact;
+                        }
+                    } else {
+                        double dz = zz_[jj] - zz_[jj-ii];
+                        for (int kk = 0; kk < numfuncs_; kk++) {
+                            dd_[jj][kk] = (dd_[jj][kk] - dd_[jj-1][kk]) / dz;
+                        }
+                    }
+                }
+            }
+        }
+
+        /**
+         * Evaluates all interpolating polynomials at the given abscissa
+         *
+         * @param Abscissa to evaluate at
+         * @param Output array of values, one per function
+         * @param Output array of first derivatives, one per function
+         * @param Output array of second derivatives, one per function
+         */
+        void eval(double tt, double* ans, double* dans, double* ddans) const {
+            int nn = numnodes_-1;
+            for (int kk = 0; kk < numfuncs_; kk++) {
+                ans[kk] = dd_[nn][kk];
+                dans[kk] = 0;
+                ddans[kk] = 0;
+            }
+            for (int ii = nn-1; ii >= 0; ii--) {
+                double dt = tt - zz_[ii];
+                for (int kk = 0; kk < numfuncs_; kk++) {
+                    ddans[kk] = ddans[kk]*dt + 2*dans[kk];
+                    dans[kk] = dans[kk]*dt + ans[kk];
+                    ans[kk] = dd_[ii][kk] + dt*ans[kk];
+                }
+            }
+        }
+
+    public:
+        int numpts_, numfuncs_, order_, numnodes_;
+        double xx_[MAXPTS];
+        double fx_[MAXPTS][3][MAXFUNCS];
+        double zz_[3*MAXPTS];
+        double dd_[3*MAXPTS][MAXFUNCS];
+};
+
 #endif
@@ -2,73 +2,351 @@
 #define ASTRO_EPHEMERIS_IO_H
 
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include "string_extra.h"
 #include "ephemeris.h"
+#include "mapped_file.h"
+#include "parallel.h"
 
-bool writeEphemToAGI(std::string outfile, Ephemeris& ephem) {
+/**
+ * Writes an AGI ephemeris file one state at a time
+ *
+ * The header includes the number of points, so it has to be known when the
+ * file is opened. Rows are formatted with formatFixed into a large buffer
+ * that is written out in big blocks, giving the same text as fprintf with
+ * "%.6lf" times and positions and "%.12lf" velocities.
+ */
+class AGIWriter {
+    public:
+        AGIWriter() {
+            fp_ = NULL;
+            len_ = 0;
+            ok_ = false;
+        }
+
+        ~AGIWriter() {
+            close();
+        }
+
+        /**
+         * Opens the file and writes the header
+         *
+         * @param File to write
+         * @param Ephemeris to take the frame and interpolation settings from
+         * @param Time of the first state, used as the scenario epoch
+         * @param Number of states that will be written
+         *
+         * @return True if the file was opened
+         */
+        bool open(std::string outfile, const Ephemeris& ephem, Timecode epoch, long numPoints) {
+            close();
+            fp_ = fopen(outfile.c_str(), "w");
+            if (fp_ == NULL) return false;
+            epoch_ = epoch;
+            buffer_.resize(bufferSize_);
+            len_ = 0;
+            ok_ = true;
+
+            fprintf(fp_, "stk.v.4.3\n\n");
+            fprintf(fp_, "BEGIN Ephemeris\n\n");
+
+            fprintf(fp_, "ScenarioEpoch %s\n", epoch_.getStrAGI().c_str());
+
+            std::string csystem = "UNKNOWN FRAME";
+            switch(ephem.csystem_) {
+                case FIXED    : csystem = "FIXED"; break;
+                case INERTIAL : csystem = "ICRF";  break;
+                case TEME     : csystem = "TEMEOfEpoch";  break;
+                case J2000    : csystem = "J2000"; break;
+            }
+            fprintf(fp_, "CoordinateSystem %s\n", csystem.c_str());
+            if (ephem.csystem_ == TEME) {
+                Timecode csystemEpoch = ephem.csystemEpoch_;
+                fprintf(fp_, "CoordinateSystemEpoch %s\n", csystemEpoch.getStrAGI().c_str());
+            }
+
+            if (ephem.interpMethod_ == HERMITE) {
+                fprintf(fp_, "InterpolationMethod Hermite\n");
+            }
+
+            fprintf(fp_, "NumberOfEphemerisPoints %ld\n", numPoints);
+
+            fprintf(fp_, "\nEphemerisTimePosVel\n");
+            return true;
+        }
+
+        /**
+         * Writes one state
+         */
+        void write(const StateVec& sv) {
+            if (bufferSize_ - len_ < maxRowLength_) flush();
+            len_ += formatRow(&buffer_[len_], sv, epoch_);
+        }
+
+        /**
+         * Writes a run of states, formatting blocks of rows concurrently
+         *
+         * Blocks are written in order, so the file is the same as writing the
+         * states one at a time.
+         *
+         * @param States to write
+         * @param Number of states
+         * @param Number of threads, zero or less for one per hardware thread
+         */
+        void write(const StateVec* states, long count, int nthreads) {
+            long nworkers = numWorkers(nthreads);
+            if (nworkers == 1) {
+                for (long ii = 0; ii < count; ii++) write(states[ii]);
+                return;
+            }
+
+            flush();
+            const long blockRows = 16384;
+            std::vector<std::vector<char> > blocks(nworkers);
+            for (long first = 0; first < count; first += nworkers*blockRows) {
+                long nblocks = (count - first + blockRows - 1)/blockRows;
+                if (nblocks > nworkers) nblocks = nworkers;
+                parallelFor(nblocks, nworkers, [&](long begin, long end) {
+                    for (long bb = begin; bb < end; bb++) {
+                        long row = first + bb*blockRows;
+                        long stop = (row + blockRows < count) ? row + blockRows : count;
+                        std::vector<char>& block = blocks[bb];
+                        size_t len = 0;
+                        for (; row < stop; row++) {
+                            if (block.size() < len + maxRowLength_) block.resize(2*(len + maxRowLength_));
+                            len += formatRow(&block[len], states[row], epoch_);
+                        }
+                        block.resize(len);
+                    }
+                });
+                for (long bb = 0; bb < nblocks; bb++) {
+                    if (fwrite(&blocks[bb][0], 1, blocks[bb].size(), fp_) != blocks[bb].size()) ok_ = false;
+                }
+            }
+        }
+
+        /**
+         * Writes the trailer and closes the file
+         *
+         * @return True if a file was open and everything was written
+         */
+        bool close() {
+            if (fp_ == NULL) return false;
+
+            flush();
+            fprintf(fp_, "\nEND Ephemeris\n");
+            if (fclose(fp_) != 0) ok_ = false;
+            fp_ = NULL;
+            std::vector<char>().swap(buffer_);
+
+            return ok_;
+        }
+
+        /**
+         * Formats one row of the "EphemerisTimePosVel" section
+         *
+         * @param Output buffer with room for maxRowLength_ characters
+         * @param State to format
+         * @param Scenario epoch the row time is relative to
+         *
+         * @return Number of characters written, including the newline
+         */
+        static size_t formatRow(char* out, const StateVec& sv, Timecode epoch) {
+            size_t len = formatFixed(out, sv.tc_ - epoch, 6);
+            const double vals[6] = {sv.pos_.x_, sv.pos_.y_, sv.pos_.z_, sv.vel_.x_, sv.vel_.y_, sv.vel_.z_};
+            for (int ii = 0; ii < 6; ii++) {
+                out[len++] = ' ';
+                len += formatFixed(out + len, vals[ii], (ii < 3) ? 6 : 12);
+            }
+            out[len++] = '\n';
+            return len;
+        }
+
+        static const size_t maxRowLength_ = 7*350 + 8;
+
+    private:
+        AGIWriter(const AGIWriter&);
+        AGIWriter& operator=(const AGIWriter&);
+
+        void flush() {
+            if (len_ > 0 && fwrite(&buffer_[0], 1, len_, fp_) != len_) ok_ = false;
+            len_ = 0;
+        }
+
+        static const size_t bufferSize_ = 1 << 20;
+
+    private:
+        FILE* fp_;
+        Timecode epoch_;
+        std::vector<char> buffer_;
+        size_t len_;
+        bool ok_;
+};
+
+/**
+ * Writes an ephemeris to an AGI file
+ *
+ * @param File to write
+ * @param Ephemeris to write, the first state's time is the scenario epoch
+ * @param Number of threads formatting rows, zero or less for one per hardware thread
+ *
+ * @return True if the file was written
+ */
+bool writeEphemToAGI(std::string outfile, const Ephemeris& ephem, int nthreads = 1) {
     if (ephem.states_.size() == 0) return false;
 
-    FILE* fp = fopen(outfile.c_str(), "w");
+    AGIWriter writer;
+    if (!writer.open(outfile, ephem, ephem.states_[0].tc_, ephem.states_.size())) return false;
+    writer.write(&ephem.states_[0], ephem.states_.size(), nthreads);
 
-    fprintf(fp, "stk.v.4.3\n\n");
-    fprintf(fp, "BEGIN Ephemeris\n\n");
+    return writer.close();
+}
 
-    fprintf(fp, "ScenarioEpoch %s\n", ephem.states_[0].tc_.getStrAGI().c_str());
+/**
+ * Resamples an ephemeris to the given time step and writes it to an AGI
+ * file without holding the resampled ephemeris in memory
+ *
+ * @param File to write
+ * @param Ephemeris to resample
+ * @param Time step of the output in seconds
+ * @param Number of points to use in interpolation
+ *
+ * @return True if the file was written
+ */
+bool writeResampledToAGI(std::string outfile, const Ephemeris& ephem, double step, int numpts = 4) {
+    if (ephem.states_.size() == 0) return false;
 
-    std::string csystem = "UNKNOWN FRAME";
-    switch(ephem.csystem_) {
-        case FIXED    : csystem = "FIXED"; break;
-        case INERTIAL : csystem = "ICRF";  break;
-        case TEME     : csystem = "TEMEOfEpoch";  break;
-        case J2000    : csystem = "J2000"; break;
-    }
-    fprintf(fp, "CoordinateSystem %s\n", csystem.c_str());
-    if (ephem.csystem_ == TEME) {
-        fprintf(fp, "CoordinateSystemEpoch %s\n", ephem.csystemEpoch_.getStrAGI().c_str());
-    }
+    Timecode tc0 = ephem.states_.front().tc_;
+    StepGrid grid(tc0, ephem.states_.back().tc_, step);
 
-    fprintf(fp, "NumberOfEphemerisPoints %ld\n", ephem.states_.size());
+    AGIWriter writer;
+    if (!writer.open(outfile, ephem, tc0, grid.size())) return false;
+    ephem.streamToStep(step, [&writer](const StateVec& sv) {
+        writer.write(sv);
+    }, numpts);
+
+    return writer.close();
+}
 
-    fprintf(fp, "\nEphemerisTimePosVel\n");
-    for (int ii = 0; ii < (int)ephem.states_.size(); ii++) {
-        fprintf(
-            fp, "%.6lf %.6lf %.6lf %.6lf %.12lf %.12lf %.12lf\n",
-            ephem.states_[ii].tc_ - ephem.states_[0].tc_,
-            ephem.states_[ii].pos_.x_, ephem.states_[ii].pos_.y_, ephem.states_[ii].pos_.z_, 
-            ephem.states_[ii].vel_.x_, ephem.states_[ii].vel_.y_, ephem.states_[ii].vel_.z_
-        );
+/**
+ * Reads one "EphemerisTimePosVel" row
+ *
+ * @param Start of the row
+ * @param End of the buffer
+ * @param Scenario epoch the row times are relative to
+ * @param Output state
+ *
+ * @return False if the row doesn't start with seven numbers
+ */
+inline bool scanAGIRow(const char* pos, const char* end, const Timecode& epoch, StateVec& sv) {
+    double vals[7];
+    for (int ii = 0; ii < 7; ii++) {
+        pos = scanDouble(pos, end, &vals[ii]);
+        if (pos == NULL) return false;
     }
+    sv = StateVec(epoch + vals[0], Vec3(vals[1], vals[2], vals[3]), Vec3(vals[4], vals[5], vals[6]));
+    return true;
+}
 
-    fprintf(fp, "\nEND Ephemeris\n");
+/**
+ * States read from a range of "EphemerisTimePosVel" rows
+ */
+struct AGIChunk {
+    std::vector<StateVec> states_;
+    bool foundEnd_;     // Reached the "END Ephemeris" line
+    bool invalid_;      // Stopped at a line that isn't a row
+};
 
-    fclose(fp);
+/**
+ * Reads the rows that start in a range of an ephemeris body
+ *
+ * Stops at "END Ephemeris" or at the first line that isn't a row.
+ *
+ * @param First line of the range
+ * @param End of the range, lines starting before it are read to their end
+ * @param End of the buffer
+ * @param Scenario epoch the row times are relative to
+ * @param Output states and where scanning stopped
+ */
+inline void scanAGIRows(const char* pos, const char* stop, const char* end, const Timecode& epoch, AGIChunk& chunk) {
+    chunk.foundEnd_ = false;
+    chunk.invalid_ = false;
+    while (pos < stop) {
+        const char* eol = (const char*)memchr(pos, '\n', end - pos);
+        if (eol == NULL) eol = end;
 
-    return true;
+        const char* first = pos;
+        while (first < eol && (*first == ' ' || *first == '\t' || *first == '\r')) first++;
+        pos = (eol < end) ? eol + 1 : end;
+
+        // Skip empty lines
+        if (first == eol) continue;
+
+        if (*first == 'E' && eol - first >= 13 && memcmp(first, "END Ephemeris", 13) == 0) {
+            chunk.foundEnd_ = true;
+            return;
+        }
+
+        // XXX Need to account for pos/posvel/posvelacc
+        StateVec sv;
+        if (!scanAGIRow(first, eol, epoch, sv)) {
+            chunk.invalid_ = true;
+            return;
+        }
+        chunk.states_.push_back(sv);
+    }
 }
 
-Ephemeris readEphemAGI(std::string filename) {
+/**
+ * Reads an AGI ephemeris file
+ *
+ * The file is memory mapped. Header lines are parsed as strings until the
+ * "EphemerisTimePosVel" line, after which rows are scanned straight out of
+ * the mapping with scanDouble, giving the same values as sscanf. States are
+ * reserved from "NumberOfEphemerisPoints" when the header has it.
+ *
+ * With more than one thread, a large body is cut into byte ranges at line
+ * boundaries that are scanned concurrently and joined in order. Rows after
+ * the first "END Ephemeris" are dropped and errors after it are ignored, as
+ * when reading serially, so the result doesn't depend on the thread count.
+ *
+ * @param File to read
+ * @param Number of threads, zero or less for one per hardware thread
+ *
+ * @return Ephemeris in the file
+ */
+Ephemeris readEphemAGI(std::string filename, int nthreads = 1) {
     Ephemeris ephem;
 
-    std::ifstream infile(filename.c_str());
+    MappedFile file;
+    if (!file.open(filename)) throw "Unable to open AGI ephem file";
+    const char* pos = file.data();
+    const char* end = pos + file.size();
 
     bool epochFound = false;
     bool csystemFound = false;
     bool csystemEpochFound = false;
     bool atEphemLines = false;
     bool foundEnd = false;
+    long numPoints = 0;
 
     Timecode epoch;
 
-    // Parse line by line
-    std::string line;
-    while (std::getline(infile, line)) {
+    // Parse header line by line
+    while (pos < end && !atEphemLines) {
+        const char* eol = (const char*)memchr(pos, '\n', end - pos);
+        if (eol == NULL) eol = end;
+        std::string line(pos, eol - pos);
+        pos = (eol < end) ? eol + 1 : end;
+
         // Skip empty lines
         if (line.find_first_not_of(' ') == std::string::npos) {
             continue;
         }
-        
+
         if (!epochFound && line.find("ScenarioEpoch") != std::string::npos) {
             epochFound = true;
             std::vector<std::string> tmp = strSplit(line, ' ');
@@ -87,7 +365,7 @@ Ephemeris readEphemAGI(std::string filename) {
                 ephem.csystem_ = FIXED;
             } else if (tmp[1] == "ICRF") {
                 ephem.csystem_ = INERTIAL;
-            } else if (tmp[1] == "TEME") {
+            } else if (tmp[1] == "TEME" || tmp[1] == "TEMEOfEpoch") {
                 ephem.csystem_ = TEME;
             } else if (tmp[1] == "J2000") {
                 ephem.csystem_ = J2000;
@@ -99,7 +377,24 @@ Ephemeris readEphemAGI(std::string filename) {
             if (tmp.size() != 5) {
                 throw "Invalid \"CoordinateSystemEpoch\" line in AGI ephem file";
             }
-            ephem.csystemEpoch_ = Timecode::parseAGI(tmp[1]);
+            ephem.csystemEpoch_ = Timecode::parseAGI(tmp[1] + " " + tmp[2] + " " + tmp[3] + " " + tmp[4]);
+        }
+
+        if (line.find("InterpolationMethod") != std::string::npos) {
+            std::vector<std::string> tmp = strSplit(line, ' ');
+            if (tmp.size() != 2) {
+                throw "Invalid \"InterpolationMethod\" line in AGI ephem file";
+            }
+            if (tmp[1] == "Hermite") {
+                ephem.interpMethod_ = HERMITE;
+            } else {
+                ephem.interpMethod_ = LAGRANGE;
+            }
+        }
+
+        if (line.find("NumberOfEphemerisPoints") != std::string::npos) {
+            std::vector<std::string> tmp = strSplit(line, ' ');
+            if (tmp.size() == 2) numPoints = atol(tmp[1].c_str());
         }
 
         if (line.find("EphemerisTimePosVel") != std::string::npos) {
@@ -111,24 +406,64 @@ Ephemeris readEphemAGI(std::string filename) {
             foundEnd = true;
             break;
         }
+    }
 
-        if (atEphemLines) {
-            // XXX Need to account for pos/posvel/posvelacc
-            Vec3 pos, vel;
-            double sec;
-            int vals = sscanf(
-                line.c_str(), "%lf %lf %lf %lf %lf %lf %lf",
-                &sec, &pos.x_, &pos.y_, &pos.z_, &vel.x_, &vel.y_, &vel.z_
-            );
-            if (vals != 7) {
-                throw ("Invalid \"EphemerisTimePosVel\" line in AGI ephem file: " + line).c_str();
+    if (atEphemLines) {
+        // The count only sizes allocations, a row takes at least 14 bytes
+        long maxPoints = (end - pos)/14 + 1;
+        if (numPoints < 0 || numPoints > maxPoints) numPoints = maxPoints;
+
+        // Ranges of at least a MB, so small files are read serially
+        long nchunks = numWorkers(nthreads);
+        long minChunk = 1 << 20;
+        if (nchunks > (end - pos)/minChunk) nchunks = (end - pos)/minChunk;
+        if (nchunks < 1) nchunks = 1;
+
+        std::vector<AGIChunk> chunks(nchunks);
+        const char* body = pos;
+        parallelFor(nchunks, nchunks, [&](long begin, long stop) {
+            for (long cc = begin; cc < stop; cc++) {
+                const char* cpos = body + (end - body)*cc/nchunks;
+                const char* cstop = body + (end - body)*(cc+1)/nchunks;
+
+                // Start at the first line beginning in the range
+                if (cc > 0 && *(cpos - 1) != '\n') {
+                    const char* nl = (const char*)memchr(cpos, '\n', end - cpos);
+                    cpos = (nl == NULL) ? end : nl + 1;
+                }
+                // Share of the count, at most what the range could hold
+                long reserve = numPoints/nchunks + 1;
+                if (reserve > (cstop - cpos)/14 + 1) reserve = (cstop - cpos)/14 + 1;
+                if (cstop > cpos) chunks[cc].states_.reserve(reserve);
+                scanAGIRows(cpos, cstop, end, epoch, chunks[cc]);
+            }
+        });
+
+        // Join ranges up to the end line, later ranges never get reached
+        long nused = 0;
+        while (nused < nchunks) {
+            const AGIChunk& chunk = chunks[nused++];
+            if (chunk.invalid_) throw "Invalid \"EphemerisTimePosVel\" line in AGI ephem file";
+            if (chunk.foundEnd_) {
+                foundEnd = true;
+                break;
             }
-            StateVec sv(epoch + sec, pos, vel);
-            ephem.states_.push_back(sv);
         }
-    }
 
-    infile.close();
+        if (nused == 1) {
+            ephem.states_.swap(chunks[0].states_);
+        } else {
+            std::vector<size_t> offsets(nused + 1, 0);
+            for (long cc = 0; cc < nused; cc++) offsets[cc+1] = offsets[cc] + chunks[cc].states_.size();
+            ephem.states_.resize(offsets[nused]);
+            parallelFor(nused, nused, [&](long begin, long stop) {
+                for (long cc = begin; cc < stop; cc++) {
+                    std::copy(chunks[cc].states_.begin(), chunks[cc].states_.end(), ephem.states_.begin() + offsets[cc]);
+                    std::vector<StateVec>().swap(chunks[cc].states_);
+                }
+            });
+        }
+    }
 
     // Invalid inputs
     if (!epochFound)
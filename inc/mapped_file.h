@@ -0,0 +1,105 @@
+#ifndef ASTRO_MAPPED_FILE_H
+#define ASTRO_MAPPED_FILE_H
+
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * Read only memory map of a whole file
+ *
+ * The contents are paged in by the OS as they are touched, so large files can
+ * be scanned without copying them into heap buffers or std::strings.
+ */
+class MappedFile {
+    public:
+        MappedFile() {
+            data_ = NULL;
+            size_ = 0;
+        }
+
+        /**
+         * Maps a file, throwing if it can't be opened
+         *
+         * @param File to map
+         */
+        MappedFile(std::string filename) {
+            data_ = NULL;
+            size_ = 0;
+            if (!open(filename)) throw "Unable to map file";
+        }
+
+        ~MappedFile() {
+            close();
+        }
+
+        /**
+         * Maps a file, unmapping any previous one
+         *
+         * @param File to map
+         *
+         * @return True if the file was mapped, an empty file maps to no data
+         */
+        bool open(std::string filename) {
+            close();
+
+            int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0) return false;
+
+            struct stat st;
+            if (fstat(fd, &st) != 0) {
+                ::close(fd);
+                return false;
+            }
+
+            if (st.st_size > 0) {
+                void* ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (ptr == MAP_FAILED) {
+                    ::close(fd);
+                    return false;
+                }
+                madvise(ptr, st.st_size, MADV_SEQUENTIAL);
+                data_ = (const char*)ptr;
+                size_ = st.st_size;
+            }
+
+            // The mapping stays valid after the descriptor is closed
+            ::close(fd);
+            return true;
+        }
+
+        /**
+         * Hints how the mapping will be accessed, files are opened for
+         * sequential reads
+         *
+         * @param madvise advice, such as MADV_RANDOM
+         */
+        void advise(int advice) {
+            if (data_ != NULL) madvise((void*)data_, size_, advice);
+        }
+
+        void close() {
+            if (data_ != NULL) munmap((void*)data_, size_);
+            data_ = NULL;
+            size_ = 0;
+        }
+
+        const char* data() const {
+            return data_;
+        }
+
+        size_t size() const {
+            return size_;
+        }
+
+    private:
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+
+        const char* data_;
+        size_t size_;
+};
+
+#endif
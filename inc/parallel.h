@@ -0,0 +1,76 @@
+#ifndef ASTRO_PARALLEL_H
+#define ASTRO_PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <exception>
+#include <system_error>
+
+/**
+ * Gets the number of worker threads to use
+ *
+ * @param Requested number of threads, zero or less for one per hardware thread
+ *
+ * @return Number of threads, at least one
+ */
+int numWorkers(int nthreads) {
+    if (nthreads > 0) return nthreads;
+    int hw = std::thread::hardware_concurrency();
+    return (hw > 0) ? hw : 1;
+}
+
+/**
+ * Runs func(begin, end) over contiguous chunks of [0, count) concurrently
+ *
+ * The range is split into one chunk per thread, so each worker can keep its
+ * own state (propagator copies, interpolation cursors) across its chunk and
+ * results written by index come out in order regardless of scheduling. With a
+ * single thread the function runs inline, and a chunk whose thread can't be
+ * started runs on the calling thread instead. The first exception thrown by
+ * any chunk is rethrown once all threads have finished.
+ *
+ * @param Number of items
+ * @param Number of threads, zero or less for one per hardware thread
+ * @param Callable taking (long begin, long end)
+ */
+template <class Func>
+void parallelFor(long count, int nthreads, Func func) {
+    if (count <= 0) return;
+
+    long nworkers = numWorkers(nthreads);
+    if (nworkers > count) nworkers = count;
+    if (nworkers == 1) {
+        func(0L, count);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(nworkers);
+    std::vector<std::thread> threads;
+    threads.reserve(nworkers);
+    for (long ii = 0; ii < nworkers; ii++) {
+        long begin = count*ii/nworkers;
+        long end = count*(ii+1)/nworkers;
+        std::exception_ptr* error = &errors[ii];
+        auto work = [=, &func]() {
+            try {
+                func(begin, end);
+            } catch (...) {
+                *error = std::current_exception();
+            }
+        };
+        try {
+            threads.push_back(std::thread(work));
+        } catch (const std::system_error&) {
+            work();
+        }
+    }
+
+    for (long ii = 0; ii < (long)threads.size(); ii++) {
+        threads[ii].join();
+    }
+    for (long ii = 0; ii < nworkers; ii++) {
+        if (errors[ii]) std::rethrow_exception(errors[ii]);
+    }
+}
+
+#endif
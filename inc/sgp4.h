@@ -1,29 +1,73 @@
 #ifndef ASTRO_SGP4_H
 #define ASTRO_SGP4_H
 
+#include <vector>
+#include <map>
+#include <atomic>
+
 #include "vallado_sgp4.h"
+#include "sgp4_near.h"
+#include "sgp4_deep.h"
+#include "tle_parse.h"
 #include "statevec.h"
 
+/**
+ * Mutable state of propagating a TLE, kept apart from its elements
+ *
+ * TLE::getState(tc, context) doesn't modify the TLE, so one TLE can be shared
+ * by any number of threads as long as each uses its own context. A context
+ * follows one element set at a time and resets itself when used with another,
+ * so a worker can keep a single context for all of its requests.
+ */
+struct Sgp4Context {
+    Sgp4Context() {
+        reset(0);
+    }
+
+    /**
+     * Forgets all integrator state
+     *
+     * @param Identifier of the element set the context follows next
+     */
+    void reset(unsigned long owner) {
+        owner_ = owner;
+        error_ = 0;
+        integrator_.atime = 0.0;
+        integrator_.xli = 0.0;
+        integrator_.xni = 0.0;
+        resonance_.clear();
+    }
+
+    unsigned long owner_;
+    int error_;     // Vallado error code of the last propagation
+    ResonanceState integrator_;
+
+    // Resonance integrator checkpoints by signed step count from epoch
+    std::map<long, ResonanceState> resonance_;
+};
+
 class TLE{
     public:
-        TLE(std::string line0, std::string line1) {
-            // Store/convert line data
-            line0_ = line0;
-            line1_ = line1;
-            vector<char> cstr1(line0.c_str(), line0.c_str() + line0.size() + 1);
-            vector<char> cstr2(line1.c_str(), line1.c_str() + line1.size() + 1);
-
-            // Vallado inputs
-            char typerun = 'c';
-            char typeinput = 'm';
-            Vallado::gravconsttype whichconst = Vallado::wgs72;
+        /**
+         * Parses and initializes a TLE, throwing if the lines are malformed
+         *
+         * @param First line of the element set
+         * @param Second line of the element set
+         * @param Gravity model, operation mode and run type
+         */
+        TLE(TextSpan line0, TextSpan line1, const TleOptions& options = TleOptions()) {
+            if (options.typerun_ != 'c' && options.typerun_ != 'v') {
+                throw "TLE typerun must be 'c' or 'v'";
+            }
+
+            // Store line data
+            line0_.assign(line0.data_, line0.size_);
+            line1_.assign(line1.data_, line1.size_);
+            options_ = options;
 
             // Initialize element set
-            double startmfe, stopmfe, deltamin;
-            Vallado::twoline2rv(
-                cstr1.data(), cstr2.data(), typerun, typeinput, 'a', whichconst,
-                startmfe, stopmfe, deltamin, satrec_
-            );
+            const char* error = parseTLE(line0, line1, options, satrec_, startmfe_, stopmfe_, deltamin_);
+            if (error != NULL) throw error;
 
             // Set epoch
             DateTime dt;
@@ -32,24 +76,197 @@ class TLE{
                 dt.year, dt.month, dt.day, dt.hour, dt.min, dt.secs
             );
             epoch_ = Timecode(dt);
+
+            resolveVariant();
         }
 
-        StateVec getState(Timecode tc) {
-            double pos[3], vel[3];
-            Vallado::sgp4(satrec_, (tc - epoch_)/60.0, pos, vel);
+        /**
+         * Reinitializes the element set with another gravity model or operation
+         * mode, without reparsing the text
+         *
+         * The mean elements parsed from the text are kept in satrec_, so this
+         * reruns sgp4init exactly as the constructor would have. The run type
+         * only affects parsing and is kept.
+         *
+         * @param Gravity model and operation mode to use
+         */
+        void reinit(const TleOptions& options) {
+            options_.whichconst_ = options.whichconst_;
+            options_.opsmode_ = options.opsmode_;
+            Vallado::sgp4init(
+                options_.whichconst_, options_.opsmode_, satrec_.satnum,
+                (satrec_.jdsatepoch + satrec_.jdsatepochF) - 2433281.5, satrec_.bstar,
+                satrec_.ndot, satrec_.nddot, satrec_.ecco, satrec_.argpo, satrec_.inclo,
+                satrec_.mo, satrec_.no_kozai, satrec_.nodeo, satrec_
+            );
+            resolveVariant();
+        }
+
+        /**
+         * Picks the propagation path for the current element set
+         *
+         * Near earth simple and full drag models run sgp4Near specialized for
+         * their model, with constants derived from the elements computed here.
+         * Deep space sets go through sgp4Deep, resonant ones with integrator
+         * checkpoints. Called by the constructor, call it again after
+         * changing satrec_. The element set gets a new identifier, so
+         * contexts drop integrator state from the old elements.
+         */
+        void resolveVariant() {
+            id_ = nextId();
+            context_.reset(id_);
+            if (satrec_.method == 'd') {
+                propagator_ = (satrec_.irez != 0) ? &TLE::propagateResonant : &TLE::propagateDeep;
+            } else {
+                near_.setLane(0, satrec_);
+                propagator_ = (satrec_.isimp == 1) ? &TLE::propagateNear<true> : &TLE::propagateNear<false>;
+            }
+        }
+
+        /**
+         * Propagates to a time without modifying the TLE
+         *
+         * @param Time to propagate to
+         * @param Propagation state of the calling thread, with the Vallado
+         *        error code in error_ afterwards
+         *
+         * @return State in TEME, m and m/s
+         */
+        StateVec getState(Timecode tc, Sgp4Context& context) const {
+            if (context.owner_ != id_) context.reset(id_);
+            double pos[3] = {0, 0, 0}, vel[3] = {0, 0, 0};
+            context.error_ = (this->*propagator_)((tc - epoch_)/60.0, pos, vel, context);
+
             return StateVec(
                 tc, Vec3(pos[0], pos[1], pos[2])*1000.0,
                 Vec3(vel[0], vel[1], vel[2])*1000.0
             );
         }
 
+        /**
+         * Propagates to a time using the TLE's own context
+         *
+         * Not safe to call on one TLE from several threads. The error code is
+         * left in satrec_.error.
+         */
+        StateVec getState(Timecode tc) {
+            StateVec sv = getState(tc, context_);
+            satrec_.t = (tc - epoch_)/60.0;
+            satrec_.error = context_.error_;
+            return sv;
+        }
+
+    private:
+        typedef int (TLE::*Propagator)(double tsince, double pos[3], double vel[3], Sgp4Context& context) const;
+
+        /**
+         * Gets a new identifier for an initialized element set
+         */
+        static unsigned long nextId() {
+            static std::atomic<unsigned long> counter(0);
+            return ++counter;
+        }
+
+        template <bool ISIMP>
+        int propagateNear(double tsince, double pos[3], double vel[3], Sgp4Context& context) const {
+            Pack<double, 1> rr[3], vv[3];
+            int error;
+            sgp4Near<ISIMP, ScalarMath>(near_, Pack<double, 1>(tsince), rr, vv, &error);
+            for (int ii = 0; ii < 3; ii++) {
+                pos[ii] = rr[ii][0];
+                vel[ii] = vv[ii][0];
+            }
+            return error;
+        }
+
+        int propagateDeep(double tsince, double pos[3], double vel[3], Sgp4Context& context) const {
+            return sgp4Deep(satrec_, context.integrator_, tsince, pos, vel);
+        }
+
+        int propagateResonant(double tsince, double pos[3], double vel[3], Sgp4Context& context) const {
+            seedResonance(tsince, context);
+            int error = sgp4Deep(satrec_, context.integrator_, tsince, pos, vel);
+            saveResonance(context);
+            return error;
+        }
+
+        // Step size of the resonance integrator in Vallado::dspace, minutes
+        static constexpr double resonanceStep_ = 720.0;
+
+        // Integrator steps between the checkpoints kept on the way to a time
+        static const long resonanceSpacing_ = 16;
+
+        /**
+         * Starts the resonance integrator from the nearest checkpoint
+         *
+         * dspace integrates from epoch in fixed steps and only continues from
+         * its last state when the new time is further out on the same side,
+         * so out of order queries would restart from epoch. The integrator
+         * stops at the last whole step before the requested time. Starting it
+         * from a checkpoint between epoch and that step does the same
+         * arithmetic as integrating from epoch, so states are unchanged.
+         * Long integrations are broken into hops that each leave a checkpoint.
+         *
+         * @param Minutes since epoch about to be propagated to
+         * @param Context holding the integrator state and checkpoints
+         */
+        void seedResonance(double tsince, Sgp4Context& context) const {
+            long last = (long)(fabs(tsince)/resonanceStep_);
+            long dir = (tsince > 0.0) ? 1 : -1;
+            if (last == 0) return;
+
+            // Nearest checkpoint between epoch and the last step
+            std::map<long, ResonanceState>& resonance = context.resonance_;
+            long kk = 0;
+            std::map<long, ResonanceState>::iterator it;
+            if (dir > 0) {
+                it = resonance.upper_bound(last);
+                if (it != resonance.begin() && (--it)->first > 0) kk = it->first;
+            } else {
+                it = resonance.lower_bound(-last);
+                if (it != resonance.end() && it->first < 0) kk = it->first;
+            }
+
+            double pos[3], vel[3];
+            while (true) {
+                if (kk != 0) {
+                    context.integrator_ = resonance[kk];
+                } else {
+                    context.integrator_.atime = 0.0;
+                }
+
+                if (last - dir*kk <= resonanceSpacing_) break;
+                kk += dir*resonanceSpacing_;
+                sgp4Deep(satrec_, context.integrator_, kk*resonanceStep_, pos, vel);
+                saveResonance(context);
+            }
+        }
+
+        /**
+         * Keeps the integrator state left by the last propagation
+         */
+        void saveResonance(Sgp4Context& context) const {
+            long kk = (long)round(context.integrator_.atime/resonanceStep_);
+            if (kk == 0) return;
+            context.resonance_[kk] = context.integrator_;
+        }
+
     public:
         string line0_, line1_;
         Timecode epoch_;
         Vallado::elsetrec satrec_;
-};
+        TleOptions options_;
+
+        // Propagation span in minutes from epoch, from line 2 with typerun 'v'
+        double startmfe_, stopmfe_, deltamin_;
 
-// Load TLE's from files
-// Find TLE's for satid
+        // Propagation state used by getState(tc)
+        Sgp4Context context_;
+
+    private:
+        unsigned long id_;
+        Propagator propagator_;
+        Sgp4NearElements<Pack<double, 1> > near_;
+};
 
 #endif
@@ -0,0 +1,405 @@
+#ifndef ASTRO_SGP4_BATCH_H
+#define ASTRO_SGP4_BATCH_H
+
+#include <vector>
+#include <math.h>
+
+#include "sgp4.h"
+#include "parallel.h"
+
+// Satellites propagated together in one block, 8 doubles fill an AVX-512
+// register and 4 fill an AVX2 one
+#ifndef SGP4_BATCH_WIDTH
+#if defined(__AVX512F__)
+#define SGP4_BATCH_WIDTH 8
+#else
+#define SGP4_BATCH_WIDTH 4
+#endif
+#endif
+
+/**
+ * Runs sgp4Near with the drag model and transcendentals picked at run time
+ *
+ * @param Simplified drag model
+ * @param Use ScalarMath rather than VectorMath
+ * @param Block of near earth elements
+ * @param Minutes since epoch for each lane
+ * @param Output position in km
+ * @param Output velocity in km/s
+ * @param Output error code for each lane, zero on success
+ */
+template <class P>
+void sgp4NearDispatch(bool simp, bool exact, const Sgp4NearElements<P>& el, const P& tsince, P rr[3], P vv[3], int* error) {
+    if (exact) {
+        if (simp) sgp4Near<true, ScalarMath>(el, tsince, rr, vv, error);
+        else sgp4Near<false, ScalarMath>(el, tsince, rr, vv, error);
+    } else {
+        if (simp) sgp4Near<true, VectorMath>(el, tsince, rr, vv, error);
+        else sgp4Near<false, VectorMath>(el, tsince, rr, vv, error);
+    }
+}
+
+/**
+ * Propagates one near earth TLE to a range of times, SGP4_BATCH_WIDTH at once
+ *
+ * Every lane holds the same elements and a different time, so the secular,
+ * drag and periodic terms of consecutive samples are computed together in
+ * vector registers. Lanes keep iterating Kepler's equation until all have
+ * converged. By default transcendentals are VectorMath polynomials and
+ * positions are within a micrometer of TLE::getState. Exact mode calls libm
+ * per lane and is bit-identical to TLE::getState, as long as floating point
+ * contraction is off (the Makefile passes -ffp-contract=off). Times that fail
+ * to propagate fall back to TLE::getState.
+ *
+ * @param Near earth TLE, check that satrec_.method isn't 'd'
+ * @param Times, anything with operator[] returning a Timecode
+ * @param First time index
+ * @param One past the last time index
+ * @param Output states, indexed like the times
+ * @param Bit-identical to TLE::getState instead of vectorized transcendentals
+ */
+template <class Times>
+void propagateNearTimes(const TLE& tle, const Times& times, long begin, long end, StateVec* states, bool exact = false) {
+    typedef Pack<double, SGP4_BATCH_WIDTH> Lanes;
+    const int W = Lanes::width;
+    if (tle.satrec_.method == 'd') throw "Deep space TLE passed to near earth propagator";
+
+    Sgp4NearElements<Lanes> el;
+    for (int ll = 0; ll < W; ll++) el.setLane(ll, tle.satrec_);
+    Sgp4Context context;
+
+    for (long ii = begin; ii < end; ii += W) {
+        int nn = (end - ii < W) ? end - ii : W;
+        Lanes tsince;
+        for (int ll = 0; ll < W; ll++) {
+            tsince[ll] = (times[ii + ((ll < nn) ? ll : nn-1)] - tle.epoch_)/60.0;
+        }
+
+        Lanes rr[3], vv[3];
+        int error[W];
+        sgp4NearDispatch(tle.satrec_.isimp == 1, exact, el, tsince, rr, vv, error);
+
+        for (int ll = 0; ll < nn; ll++) {
+            if (error[ll] != 0) {
+                states[ii + ll] = tle.getState(times[ii + ll], context);
+                continue;
+            }
+            states[ii + ll] = StateVec(
+                times[ii + ll], Vec3(rr[0][ll], rr[1][ll], rr[2][ll])*1000.0,
+                Vec3(vv[0][ll], vv[1][ll], vv[2][ll])*1000.0
+            );
+        }
+    }
+}
+
+/**
+ * Near earth satellites of a catalog grouped into blocks of lanes
+ *
+ * The simplified (perigee below 220 km) and full drag models are kept in
+ * separate blocks so each runs its own specialization of sgp4Near. The last
+ * block of each kind is padded with copies of its first satellite.
+ */
+template <class P>
+class Sgp4NearBlocks {
+    public:
+        /**
+         * Groups the near earth TLE's of a catalog
+         *
+         * @param Catalog TLE's
+         */
+        void build(const std::vector<TLE>& tles) {
+            simpIdx_.clear();
+            fullIdx_.clear();
+            for (size_t ii = 0; ii < tles.size(); ii++) {
+                const Vallado::elsetrec& satrec = tles[ii].satrec_;
+                if (satrec.method == 'd') continue;
+                if (satrec.isimp == 1) simpIdx_.push_back(ii);
+                else fullIdx_.push_back(ii);
+            }
+            fill(tles, simpIdx_, simp_);
+            fill(tles, fullIdx_, full_);
+        }
+
+        /**
+         * Gets the number of blocks
+         */
+        size_t size() const {
+            return simp_.size() + full_.size();
+        }
+
+        /**
+         * Propagates one block to a time
+         *
+         * @param Block index
+         * @param Catalog TLE's the blocks were built from
+         * @param Time to propagate to
+         * @param Use ScalarMath rather than VectorMath
+         * @param Called as out(catalog index, rr, vv, lane, error) for each
+         *        satellite, with the position and velocity lanes in km and km/s
+         */
+        template <class Output>
+        void propagate(long bb, const std::vector<TLE>& tles, Timecode tc, bool exact, Output out) const {
+            const int W = P::width;
+            bool simp = bb < (long)simp_.size();
+            if (!simp) bb -= simp_.size();
+            const int* idx = simp ? &simpIdx_[bb*W] : &fullIdx_[bb*W];
+
+            P tsince;
+            for (int ll = 0; ll < W; ll++) {
+                int kk = (idx[ll] < 0) ? idx[0] : idx[ll];
+                tsince[ll] = (tc - tles[kk].epoch_)/60.0;
+            }
+
+            P rr[3], vv[3];
+            int error[W];
+            sgp4NearDispatch(simp, exact, simp ? simp_[bb] : full_[bb], tsince, rr, vv, error);
+
+            for (int ll = 0; ll < W; ll++) {
+                if (idx[ll] >= 0) out(idx[ll], rr, vv, ll, error[ll]);
+            }
+        }
+
+    private:
+        void fill(const std::vector<TLE>& tles, std::vector<int>& idx, std::vector<Sgp4NearElements<P> >& blocks) {
+            const int W = P::width;
+            size_t nblocks = (idx.size() + W - 1)/W;
+            blocks.resize(nblocks);
+            for (size_t ii = 0; ii < nblocks*W; ii++) {
+                if (ii < idx.size()) {
+                    blocks[ii/W].setLane(ii%W, tles[idx[ii]].satrec_);
+                } else {
+                    blocks[ii/W].setLane(ii%W, tles[idx[ii - ii%W]].satrec_);
+                }
+            }
+            idx.resize(nblocks*W, -1);
+        }
+
+    private:
+        std::vector<Sgp4NearElements<P> > simp_, full_;
+        std::vector<int> simpIdx_, fullIdx_;
+};
+
+/**
+ * Single precision state for screening, position in m and velocity in m/s
+ */
+struct ScreenState {
+    float pos_[3];
+    float vel_[3];
+};
+
+/**
+ * Set of TLE's propagated together
+ *
+ * Near earth satellites are grouped into blocks of SGP4_BATCH_WIDTH lanes and
+ * run through sgp4Near with VectorMath transcendentals, so whole blocks are
+ * propagated in vector registers and states are within a micrometer of
+ * TLE::getState. Setting exact_ switches to ScalarMath for states
+ * bit-identical to TLE::getState. Deep space satellites go through
+ * TLE::getState(tc, context) one at a time with an Sgp4Context per worker, so
+ * their elements are never modified.
+ *
+ * For screening, propagateScreen runs the near earth blocks in single
+ * precision, with twice as many float lanes filling the same vector
+ * registers. The error against the double path is dominated by float
+ * rounding of the secular angles, so it grows with the time since epoch. For
+ * the 30k object synthetic LEO catalog in test/sgp4_batch.cc the median and
+ * 99.9th percentile position errors stay under 40 m and 200 m at 1 day,
+ * 300 m and 1.5 km at 7 days, 1.2 km and 6 km at 30 days, with velocity
+ * errors under 0.3, 2 and 8 m/s. Angles in the element sets are
+ * assumed to be reduced to [0, 2pi) as they are in parsed TLE's.
+ */
+class TleCatalog {
+    public:
+        typedef Pack<double, SGP4_BATCH_WIDTH> Lanes;
+        typedef Pack<float, 2*SGP4_BATCH_WIDTH> ScreenLanes;
+
+        TleCatalog() {
+            exact_ = false;
+            dirty_ = false;
+            screenDirty_ = false;
+        }
+
+        /**
+         * Adds a TLE to the catalog
+         *
+         * @param TLE to add, states come back in the order TLE's were added
+         */
+        void add(const TLE& tle) {
+            tles_.push_back(tle);
+            if (tle.satrec_.method == 'd') deepIdx_.push_back(tles_.size() - 1);
+            dirty_ = true;
+            screenDirty_ = true;
+        }
+
+        /**
+         * Reinitializes every TLE with another gravity model or operation mode
+         *
+         * Elements already parsed into each TLE are reused, so sweeping model
+         * variants over a catalog doesn't reparse any text.
+         *
+         * @param Gravity model and operation mode to use
+         * @param Number of threads, zero or less for one per hardware thread
+         */
+        void reinit(const TleOptions& options, int nthreads = 1) {
+            parallelFor(tles_.size(), nthreads, [&](long begin, long end) {
+                for (long ii = begin; ii < end; ii++) tles_[ii].reinit(options);
+            });
+
+            // Orbital period, and so the method, depends on the gravity model
+            deepIdx_.clear();
+            for (size_t ii = 0; ii < tles_.size(); ii++) {
+                if (tles_[ii].satrec_.method == 'd') deepIdx_.push_back(ii);
+            }
+            dirty_ = true;
+            screenDirty_ = true;
+        }
+
+        /**
+         * Gets the number of TLE's in the catalog
+         */
+        size_t size() const {
+            return tles_.size();
+        }
+
+        /**
+         * Propagates every TLE to a time
+         *
+         * States of satellites that fail to propagate are zero, with the
+         * Vallado error code left in errors_.
+         *
+         * @param Time to propagate to
+         * @param Output states, one per TLE in catalog order
+         * @param Number of threads, zero or less for one per hardware thread
+         */
+        void propagate(Timecode tc, std::vector<StateVec>& states, int nthreads = 1) {
+            std::vector<Timecode> times(1, tc);
+            propagate(times, states, nthreads);
+        }
+
+        /**
+         * Propagates every TLE to each time of a grid
+         *
+         * @param Times to propagate to
+         * @param Output states, time major so state jj*size() + ii is TLE ii at time jj
+         * @param Number of threads, zero or less for one per hardware thread
+         */
+        void propagate(const std::vector<Timecode>& times, std::vector<StateVec>& states, int nthreads = 1) {
+            if (dirty_) blocks_.build(tles_);
+            dirty_ = false;
+            size_t nsat = tles_.size();
+            states.resize(times.size()*nsat);
+            errors_.resize(times.size()*nsat);
+
+            parallelFor(blocks_.size(), nthreads, [&](long begin, long end) {
+                for (long bb = begin; bb < end; bb++) {
+                    for (size_t jj = 0; jj < times.size(); jj++) {
+                        StateVec* out = &states[jj*nsat];
+                        int* errors = &errors_[jj*nsat];
+                        Timecode tc = times[jj];
+                        blocks_.propagate(bb, tles_, tc, exact_, [&](int idx, const Lanes* rr, const Lanes* vv, int ll, int error) {
+                            errors[idx] = error;
+                            if (error != 0) {
+                                out[idx] = StateVec(tc, Vec3(), Vec3());
+                                return;
+                            }
+                            out[idx] = StateVec(
+                                tc, Vec3(rr[0][ll], rr[1][ll], rr[2][ll])*1000.0,
+                                Vec3(vv[0][ll], vv[1][ll], vv[2][ll])*1000.0
+                            );
+                        });
+                    }
+                }
+            });
+
+            propagateDeep(times, nthreads, [&](size_t jj, int idx, const StateVec& sv, int error) {
+                states[jj*nsat + idx] = (error != 0) ? StateVec(times[jj], Vec3(), Vec3()) : sv;
+            });
+        }
+
+        /**
+         * Propagates every TLE to each time of a grid in single precision
+         *
+         * Deep space satellites are still propagated in double precision and
+         * rounded. States of satellites that fail to propagate are zero, with
+         * the Vallado error code left in errors_.
+         *
+         * @param Times to propagate to
+         * @param Output states, time major so state jj*size() + ii is TLE ii at time jj
+         * @param Number of threads, zero or less for one per hardware thread
+         */
+        void propagateScreen(const std::vector<Timecode>& times, std::vector<ScreenState>& states, int nthreads = 1) {
+            if (screenDirty_) screenBlocks_.build(tles_);
+            screenDirty_ = false;
+            size_t nsat = tles_.size();
+            states.resize(times.size()*nsat);
+            errors_.resize(times.size()*nsat);
+
+            parallelFor(screenBlocks_.size(), nthreads, [&](long begin, long end) {
+                for (long bb = begin; bb < end; bb++) {
+                    for (size_t jj = 0; jj < times.size(); jj++) {
+                        ScreenState* out = &states[jj*nsat];
+                        int* errors = &errors_[jj*nsat];
+                        screenBlocks_.propagate(bb, tles_, times[jj], exact_, [&](int idx, const ScreenLanes* rr, const ScreenLanes* vv, int ll, int error) {
+                            errors[idx] = error;
+                            for (int kk = 0; kk < 3; kk++) {
+                                out[idx].pos_[kk] = (error != 0) ? 0.0f : rr[kk][ll]*1000.0f;
+                                out[idx].vel_[kk] = (error != 0) ? 0.0f : vv[kk][ll]*1000.0f;
+                            }
+                        });
+                    }
+                }
+            });
+
+            propagateDeep(times, nthreads, [&](size_t jj, int idx, const StateVec& sv, int error) {
+                ScreenState& out = states[jj*nsat + idx];
+                for (int kk = 0; kk < 3; kk++) {
+                    out.pos_[kk] = (error != 0) ? 0.0f : sv.pos_[kk];
+                    out.vel_[kk] = (error != 0) ? 0.0f : sv.vel_[kk];
+                }
+            });
+        }
+
+    private:
+        /**
+         * Propagates the deep space satellites one at a time
+         *
+         * Each worker keeps its own propagation context, so the TLE's aren't
+         * modified.
+         *
+         * @param Called as out(time index, catalog index, state, error)
+         */
+        template <class Output>
+        void propagateDeep(const std::vector<Timecode>& times, int nthreads, Output out) {
+            size_t nsat = tles_.size();
+            parallelFor(deepIdx_.size(), nthreads, [&](long begin, long end) {
+                Sgp4Context context;
+                for (long kk = begin; kk < end; kk++) {
+                    int idx = deepIdx_[kk];
+                    for (size_t jj = 0; jj < times.size(); jj++) {
+                        StateVec sv = tles_[idx].getState(times[jj], context);
+                        int error = context.error_;
+                        errors_[jj*nsat + idx] = error;
+                        out(jj, idx, sv, error);
+                    }
+                }
+            });
+        }
+
+    public:
+        std::vector<TLE> tles_;
+
+        // Vallado error code of each state from the last propagate
+        std::vector<int> errors_;
+
+        // Near earth blocks use ScalarMath, so states are bit-identical to
+        // TLE::getState at the cost of calling libm one lane at a time
+        bool exact_;
+
+    private:
+        bool dirty_, screenDirty_;
+        Sgp4NearBlocks<Lanes> blocks_;
+        Sgp4NearBlocks<ScreenLanes> screenBlocks_;
+        std::vector<int> deepIdx_;
+};
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef ASTRO_SGP4_DEEP_H
+#define ASTRO_SGP4_DEEP_H
+
+#include <math.h>
+
+#include "vallado_sgp4.h"
+
+/**
+ * Deep space resonance integrator state
+ */
+struct ResonanceState {
+    double atime, xli, xni;
+};
+
+/**
+ * Deep space SGP4 on a read only element set
+ *
+ * Vallado::sgp4 writes the resonance integrator state, the error code and
+ * several coefficients that depend on the perturbed inclination back into
+ * the elsetrec, so a deep space element set can't be shared between threads.
+ * This follows it operation for operation, but keeps those coefficients
+ * local and the integrator state in a separate structure, so states are
+ * bit-identical to it. Near earth sets should use sgp4Near.
+ *
+ * @param Initialized deep space element set
+ * @param Resonance integrator state, an atime of zero integrates from epoch
+ * @param Minutes since epoch
+ * @param Output position in km, undefined for errors other than 6
+ * @param Output velocity in km/s
+ *
+ * @return Vallado error code, zero on success
+ */
+inline int sgp4Deep(const Vallado::elsetrec& satrec, ResonanceState& integ, double tsince, double r[3], double v[3]) {
+    const double temp4 = 1.5e-12;
+    const double twopi = 2.0 * pi;
+    const double x2o3 = 2.0 / 3.0;
+    double vkmpersec = satrec.radiusearthkm * satrec.xke / 60.0;
+    double t = tsince;
+
+    // Secular gravity and atmospheric drag
+    double xmdf = satrec.mo + satrec.mdot * t;
+    double argpdf = satrec.argpo + satrec.argpdot * t;
+    double nodedf = satrec.nodeo + satrec.nodedot * t;
+    double argpm = argpdf;
+    double mm = xmdf;
+    double t2 = t * t;
+    double nodem = nodedf + satrec.nodecf * t2;
+    double tempa = 1.0 - satrec.cc1 * t;
+    double tempe = satrec.bstar * satrec.cc4 * t;
+    double templ = satrec.t2cof * t2;
+    double temp;
+
+    if (satrec.isimp != 1) {
+        double delomg = satrec.omgcof * t;
+        double delmtemp = 1.0 + satrec.eta * cos(xmdf);
+        double delm = satrec.xmcof * (delmtemp * delmtemp * delmtemp - satrec.delmo);
+        temp = delomg + delm;
+        mm = xmdf + temp;
+        argpm = argpdf - temp;
+        double t3 = t2 * t;
+        double t4 = t3 * t;
+        tempa = tempa - satrec.d2 * t2 - satrec.d3 * t3 - satrec.d4 * t4;
+        tempe = tempe + satrec.bstar * satrec.cc5 * (sin(mm) - satrec.sinmao);
+        templ = templ + satrec.t3cof * t3 + t4 * (satrec.t4cof + t * satrec.t5cof);
+    }
+
+    double nm = satrec.no_unkozai;
+    double em = satrec.ecco;
+    double inclm = satrec.inclo;
+    double tc = t;
+    double dndt;
+    Vallado::dspace(
+        satrec.irez,
+        satrec.d2201, satrec.d2211, satrec.d3210,
+        satrec.d3222, satrec.d4410, satrec.d4422,
+        satrec.d5220, satrec.d5232, satrec.d5421,
+        satrec.d5433, satrec.dedt, satrec.del1,
+        satrec.del2, satrec.del3, satrec.didt,
+        satrec.dmdt, satrec.dnodt, satrec.domdt,
+        satrec.argpo, satrec.argpdot, t, tc,
+        satrec.gsto, satrec.xfact, satrec.xlamo,
+        satrec.no_unkozai, integ.atime,
+        em, argpm, inclm, integ.xli, mm, integ.xni,
+        nodem, dndt, nm
+    );
+
+    if (nm <= 0.0) return 2;
+    double am = pow((satrec.xke / nm), x2o3) * tempa * tempa;
+    nm = satrec.xke / pow(am, 1.5);
+    em = em - tempe;
+
+    if ((em >= 1.0) || (em < -0.001)) return 1;
+    if (em < 1.0e-6) em = 1.0e-6;
+    mm = mm + satrec.no_unkozai * templ;
+    double xlm = mm + argpm + nodem;
+
+    nodem = fmod(nodem, twopi);
+    argpm = fmod(argpm, twopi);
+    xlm = fmod(xlm, twopi);
+    mm = fmod(xlm - argpm - nodem, twopi);
+
+    // Lunar-solar periodics
+    double ep = em;
+    double xincp = inclm;
+    double argpp = argpm;
+    double nodep = nodem;
+    double mp = mm;
+    Vallado::dpper(
+        satrec.e3, satrec.ee2, satrec.peo,
+        satrec.pgho, satrec.pho, satrec.pinco,
+        satrec.plo, satrec.se2, satrec.se3,
+        satrec.sgh2, satrec.sgh3, satrec.sgh4,
+        satrec.sh2, satrec.sh3, satrec.si2,
+        satrec.si3, satrec.sl2, satrec.sl3,
+        satrec.sl4, t, satrec.xgh2,
+        satrec.xgh3, satrec.xgh4, satrec.xh2,
+        satrec.xh3, satrec.xi2, satrec.xi3,
+        satrec.xl2, satrec.xl3, satrec.xl4,
+        satrec.zmol, satrec.zmos, satrec.inclo,
+        'n', ep, xincp, nodep, argpp, mp, satrec.operationmode
+    );
+    if (xincp < 0.0) {
+        xincp = -xincp;
+        nodep = nodep + pi;
+        argpp = argpp - pi;
+    }
+    if ((ep < 0.0) || (ep > 1.0)) return 3;
+
+    // Long period periodics
+    double sinip = sin(xincp);
+    double cosip = cos(xincp);
+    double aycof = -0.5*satrec.j3oj2*sinip;
+    double xlcof;
+    if (fabs(cosip + 1.0) > 1.5e-12) {
+        xlcof = -0.25 * satrec.j3oj2 * sinip * (3.0 + 5.0 * cosip) / (1.0 + cosip);
+    } else {
+        xlcof = -0.25 * satrec.j3oj2 * sinip * (3.0 + 5.0 * cosip) / temp4;
+    }
+    double axnl = ep * cos(argpp);
+    temp = 1.0 / (am * (1.0 - ep * ep));
+    double aynl = ep* sin(argpp) + temp * aycof;
+    double xl = mp + argpp + nodep + temp * xlcof * axnl;
+
+    // Kepler's equation
+    double u = fmod(xl - nodep, twopi);
+    double eo1 = u;
+    double tem5 = 9999.9;
+    double sineo1, coseo1;
+    int ktr = 1;
+    while ((fabs(tem5) >= 1.0e-12) && (ktr <= 10)) {
+        sineo1 = sin(eo1);
+        coseo1 = cos(eo1);
+        tem5 = 1.0 - coseo1 * axnl - sineo1 * aynl;
+        tem5 = (u - aynl * coseo1 + axnl * sineo1 - eo1) / tem5;
+        if (fabs(tem5) >= 0.95) tem5 = tem5 > 0.0 ? 0.95 : -0.95;
+        eo1 = eo1 + tem5;
+        ktr = ktr + 1;
+    }
+
+    // Short period preliminary quantities
+    double ecose = axnl*coseo1 + aynl*sineo1;
+    double esine = axnl*sineo1 - aynl*coseo1;
+    double el2 = axnl*axnl + aynl*aynl;
+    double pl = am*(1.0 - el2);
+    if (pl < 0.0) return 4;
+
+    double rl = am * (1.0 - ecose);
+    double rdotl = sqrt(am) * esine / rl;
+    double rvdotl = sqrt(pl) / rl;
+    double betal = sqrt(1.0 - el2);
+    temp = esine / (1.0 + betal);
+    double sinu = am / rl * (sineo1 - aynl - axnl * temp);
+    double cosu = am / rl * (coseo1 - axnl + aynl * temp);
+    double su = atan2(sinu, cosu);
+    double sin2u = (cosu + cosu) * sinu;
+    double cos2u = 1.0 - 2.0 * sinu * sinu;
+    temp = 1.0 / pl;
+    double temp1 = 0.5 * satrec.j2 * temp;
+    double temp2 = temp1 * temp;
+
+    // Short period periodics
+    double cosisq = cosip * cosip;
+    double con41 = 3.0*cosisq - 1.0;
+    double x1mth2 = 1.0 - cosisq;
+    double x7thm1 = 7.0*cosisq - 1.0;
+    double mrt = rl * (1.0 - 1.5 * temp2 * betal * con41) + 0.5 * temp1 * x1mth2 * cos2u;
+    su = su - 0.25 * temp2 * x7thm1 * sin2u;
+    double xnode = nodep + 1.5 * temp2 * cosip * sin2u;
+    double xinc = xincp + 1.5 * temp2 * cosip * sinip * cos2u;
+    double mvt = rdotl - nm * temp1 * x1mth2 * sin2u / satrec.xke;
+    double rvdot = rvdotl + nm * temp1 * (x1mth2 * cos2u + 1.5 * con41) / satrec.xke;
+
+    // Orientation vectors
+    double sinsu = sin(su);
+    double cossu = cos(su);
+    double snod = sin(xnode);
+    double cnod = cos(xnode);
+    double sini = sin(xinc);
+    double cosi = cos(xinc);
+    double xmx = -snod * cosi;
+    double xmy = cnod * cosi;
+    double ux = xmx * sinsu + cnod * cossu;
+    double uy = xmy * sinsu + snod * cossu;
+    double uz = sini * sinsu;
+    double vx = xmx * cossu - cnod * sinsu;
+    double vy = xmy * cossu - snod * sinsu;
+    double vz = sini * cossu;
+
+    // Position and velocity in km and km/s
+    r[0] = (mrt * ux)* satrec.radiusearthkm;
+    r[1] = (mrt * uy)* satrec.radiusearthkm;
+    r[2] = (mrt * uz)* satrec.radiusearthkm;
+    v[0] = (mvt * ux + rvdot * vx) * vkmpersec;
+    v[1] = (mvt * uy + rvdot * vy) * vkmpersec;
+    v[2] = (mvt * uz + rvdot * vz) * vkmpersec;
+
+    // Decayed
+    if (mrt < 1.0) return 6;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,230 @@
+#ifndef ASTRO_SGP4_NEAR_H
+#define ASTRO_SGP4_NEAR_H
+
+#include <math.h>
+
+#include "vallado_sgp4.h"
+#include "simd_pack.h"
+
+/**
+ * Near earth SGP4 elements for a block of satellites, one per lane
+ *
+ * Only the fields the near earth path of Vallado::sgp4 reads are kept, plus a
+ * few per satellite constants it would otherwise recompute every call. Blocks
+ * are stored contiguously, so a catalog is an array of structures of arrays.
+ */
+template <class P>
+class Sgp4NearElements {
+    public:
+        typedef typename P::value_type T;
+
+        /**
+         * Copies one satellite's elements into a lane
+         *
+         * @param Lane to set
+         * @param Initialized near earth element set
+         */
+        void setLane(int ll, const Vallado::elsetrec& satrec) {
+            mo[ll] = satrec.mo;             mdot[ll] = satrec.mdot;
+            argpo[ll] = satrec.argpo;       argpdot[ll] = satrec.argpdot;
+            nodeo[ll] = satrec.nodeo;       nodedot[ll] = satrec.nodedot;
+            nodecf[ll] = satrec.nodecf;     bstar[ll] = satrec.bstar;
+            cc1[ll] = satrec.cc1;           cc4[ll] = satrec.cc4;
+            cc5[ll] = satrec.cc5;           t2cof[ll] = satrec.t2cof;
+            t3cof[ll] = satrec.t3cof;       t4cof[ll] = satrec.t4cof;
+            t5cof[ll] = satrec.t5cof;       omgcof[ll] = satrec.omgcof;
+            xmcof[ll] = satrec.xmcof;       eta[ll] = satrec.eta;
+            delmo[ll] = satrec.delmo;       sinmao[ll] = satrec.sinmao;
+            d2[ll] = satrec.d2;             d3[ll] = satrec.d3;
+            d4[ll] = satrec.d4;             no_unkozai[ll] = satrec.no_unkozai;
+            ecco[ll] = satrec.ecco;         inclo[ll] = satrec.inclo;
+            aycof[ll] = satrec.aycof;       xlcof[ll] = satrec.xlcof;
+            con41[ll] = satrec.con41;       x1mth2[ll] = satrec.x1mth2;
+            x7thm1[ll] = satrec.x7thm1;     xke[ll] = satrec.xke;
+            j2[ll] = satrec.j2;             radiusearthkm[ll] = satrec.radiusearthkm;
+
+            // Constant for near earth orbits, sgp4 recomputes them each call
+            sinio[ll] = sin(satrec.inclo);
+            cosio[ll] = cos(satrec.inclo);
+            vkmpersec[ll] = satrec.radiusearthkm * satrec.xke / 60.0;
+            xkeno23[ll] = pow(satrec.xke / satrec.no_unkozai, 2.0 / 3.0);
+        }
+
+    public:
+        P mo, mdot, argpo, argpdot, nodeo, nodedot, nodecf, bstar;
+        P cc1, cc4, cc5, t2cof, t3cof, t4cof, t5cof, omgcof, xmcof, eta, delmo, sinmao;
+        P d2, d3, d4, no_unkozai, ecco, inclo, aycof, xlcof, con41, x1mth2, x7thm1;
+        P xke, j2, radiusearthkm, sinio, cosio, vkmpersec, xkeno23;
+};
+
+/**
+ * Convergence tolerance of the Kepler iteration
+ *
+ * Vallado's value for double. Single precision can't resolve 1e-12, so float
+ * stops once corrections are down to a few ulp of an angle.
+ */
+template <class T> inline T keplerTolerance();
+template <> inline double keplerTolerance<double>() { return 1.0e-12; }
+template <> inline float keplerTolerance<float>() { return 1.0e-6f; }
+
+/**
+ * Near earth SGP4 for every lane of a block
+ *
+ * Follows the near earth path of Vallado::sgp4 operation for operation. With
+ * ScalarMath transcendentals double precision results are bit-identical to
+ * it. With VectorMath every step runs across the lanes in vector registers,
+ * and states differ from Vallado::sgp4 by well under a micrometer. With float
+ * lanes it is a single precision screening version of the same model. The
+ * element set is not modified. Lanes that fail get their Vallado error code
+ * and an undefined state, the other lanes are unaffected.
+ *
+ * @tparam Simplified drag model
+ * @tparam ScalarMath or VectorMath
+ * @param Block of near earth elements
+ * @param Minutes since epoch for each lane
+ * @param Output position in km
+ * @param Output velocity in km/s
+ * @param Output error code for each lane, zero on success
+ */
+template <bool ISIMP, class Math, class P>
+void sgp4Near(const Sgp4NearElements<P>& el, const P& tsince, P rr[3], P vv[3], int* error) {
+    typedef typename P::value_type T;
+    typedef typename P::mask_type M;
+    const int W = P::width;
+
+    const T twopi = 2.0 * pi;
+
+    // Secular gravity and atmospheric drag
+    P t = tsince;
+    P xmdf = el.mo + el.mdot * t;
+    P argpdf = el.argpo + el.argpdot * t;
+    P nodedf = el.nodeo + el.nodedot * t;
+    P argpm = argpdf;
+    P mm = xmdf;
+    P t2 = t * t;
+    P nodem = nodedf + el.nodecf * t2;
+    P tempa = 1.0 - el.cc1 * t;
+    P tempe = el.bstar * el.cc4 * t;
+    P templ = el.t2cof * t2;
+
+    if (!ISIMP) {
+        P delomg = el.omgcof * t;
+        P delmtemp = 1.0 + el.eta * Math::cos(xmdf);
+        P delm = el.xmcof * (delmtemp * delmtemp * delmtemp - el.delmo);
+        P temp = delomg + delm;
+        mm = xmdf + temp;
+        argpm = argpdf - temp;
+        P t3 = t2 * t;
+        P t4 = t3 * t;
+        tempa = tempa - el.d2 * t2 - el.d3 * t3 - el.d4 * t4;
+        tempe = tempe + el.bstar * el.cc5 * (Math::sin(mm) - el.sinmao);
+        templ = templ + el.t3cof * t3 + t4 * (el.t4cof + t * el.t5cof);
+    }
+
+    P nm = el.no_unkozai;
+    P em = el.ecco;
+    M bad2 = nm <= 0.0;
+    P am = el.xkeno23 * tempa * tempa;
+    nm = el.xke / Math::powThreeHalves(am);
+    em = em - tempe;
+    M bad1 = (em >= 1.0) | (em < -0.001);
+    em = select(em < 1.0e-6, P(1.0e-6), em);
+    mm = mm + el.no_unkozai * templ;
+    P xlm = mm + argpm + nodem;
+
+    nodem = Math::fmod(nodem, twopi);
+    argpm = Math::fmod(argpm, twopi);
+    xlm = Math::fmod(xlm, twopi);
+    mm = Math::fmod(xlm - argpm - nodem, twopi);
+
+    // Long period periodics
+    P sinargp, cosargp;
+    Math::sincos(argpm, sinargp, cosargp);
+    P axnl = em * cosargp;
+    P temp = 1.0 / (am * (1.0 - em * em));
+    P aynl = em * sinargp + temp * el.aycof;
+    P xl = mm + argpm + nodem + temp * el.xlcof * axnl;
+
+    // Kepler's equation, every lane iterates until all have converged but
+    // lanes that already have keep their last iterate and its sine and
+    // cosine like the scalar loop does
+    P u = Math::fmod(xl - nodem, twopi);
+    P eo1 = u;
+    P sineo1, coseo1;
+    M active(true);
+    for (int ktr = 1; ktr <= 10 && active.any(); ktr++) {
+        P sn, cs;
+        Math::sincos(eo1, sn, cs);
+        sineo1 = select(active, sn, sineo1);
+        coseo1 = select(active, cs, coseo1);
+        P tem5 = 1.0 - cs * axnl - sn * aynl;
+        tem5 = (u - aynl * cs + axnl * sn - eo1) / tem5;
+        tem5 = select(fabs(tem5) >= 0.95, select(tem5 > 0.0, P(0.95), P(-0.95)), tem5);
+        eo1 = select(active, eo1 + tem5, eo1);
+        active = active & (fabs(tem5) >= keplerTolerance<T>());
+    }
+
+    // Short period preliminary quantities
+    P ecose = axnl*coseo1 + aynl*sineo1;
+    P esine = axnl*sineo1 - aynl*coseo1;
+    P el2 = axnl*axnl + aynl*aynl;
+    P pl = am*(1.0 - el2);
+    M bad4 = pl < 0.0;
+    P rl = am * (1.0 - ecose);
+    P rdotl = sqrt(am) * esine / rl;
+    P rvdotl = sqrt(pl) / rl;
+    P betal = sqrt(1.0 - el2);
+    temp = esine / (1.0 + betal);
+    P sinu = am / rl * (sineo1 - aynl - axnl * temp);
+    P cosu = am / rl * (coseo1 - axnl + aynl * temp);
+    P su = Math::atan2(sinu, cosu);
+    P sin2u = (cosu + cosu) * sinu;
+    P cos2u = 1.0 - 2.0 * sinu * sinu;
+    temp = 1.0 / pl;
+    P temp1 = 0.5 * el.j2 * temp;
+    P temp2 = temp1 * temp;
+
+    // Short period periodics
+    P mrt = rl * (1.0 - 1.5 * temp2 * betal * el.con41) +
+        0.5 * temp1 * el.x1mth2 * cos2u;
+    su = su - 0.25 * temp2 * el.x7thm1 * sin2u;
+    P xnode = nodem + 1.5 * temp2 * el.cosio * sin2u;
+    P xinc = el.inclo + 1.5 * temp2 * el.cosio * el.sinio * cos2u;
+    P mvt = rdotl - nm * temp1 * el.x1mth2 * sin2u / el.xke;
+    P rvdot = rvdotl + nm * temp1 * (el.x1mth2 * cos2u +
+        1.5 * el.con41) / el.xke;
+
+    // Orientation vectors
+    P sinsu, cossu, snod, cnod, sini, cosi;
+    Math::sincos(su, sinsu, cossu);
+    Math::sincos(xnode, snod, cnod);
+    Math::sincos(xinc, sini, cosi);
+    P xmx = -snod * cosi;
+    P xmy = cnod * cosi;
+    P ux = xmx * sinsu + cnod * cossu;
+    P uy = xmy * sinsu + snod * cossu;
+    P uz = sini * sinsu;
+    P vx = xmx * cossu - cnod * sinsu;
+    P vy = xmy * cossu - snod * sinsu;
+    P vz = sini * cossu;
+
+    // Position and velocity in km and km/s
+    rr[0] = (mrt * ux) * el.radiusearthkm;
+    rr[1] = (mrt * uy) * el.radiusearthkm;
+    rr[2] = (mrt * uz) * el.radiusearthkm;
+    vv[0] = (mvt * ux + rvdot * vx) * el.vkmpersec;
+    vv[1] = (mvt * uy + rvdot * vy) * el.vkmpersec;
+    vv[2] = (mvt * uz + rvdot * vz) * el.vkmpersec;
+
+    // Error codes in the order sgp4 checks them
+    M bad6 = mrt < 1.0;
+    for (int ll = 0; ll < W; ll++) {
+        if (bad2[ll]) error[ll] = 2;
+        else if (bad1[ll]) error[ll] = 1;
+        else if (bad4[ll]) error[ll] = 4;
+        else if (bad6[ll]) error[ll] = 6;
+        else error[ll] = 0;
+    }
+}
+
+#endif
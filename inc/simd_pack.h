@@ -0,0 +1,423 @@
+#ifndef ASTRO_SIMD_PACK_H
+#define ASTRO_SIMD_PACK_H
+
+#include <stdint.h>
+#include <cmath>
+
+/**
+ * Portable fixed width SIMD types
+ *
+ * Packs are GCC vector types, so arithmetic, comparisons, selects, sqrt and
+ * fabs compile to whatever vector instructions the target has (SSE2 by
+ * default, AVX2 or AVX-512 with -march). These are exact IEEE operations, so
+ * every lane gets the same result as the scalar expression, as long as
+ * floating point contraction is off. Packs only need the alignment of T, so
+ * they can live in std::vector.
+ *
+ * Transcendentals come in two flavours. ScalarMath calls libm one lane at a
+ * time, which keeps results bit-identical to scalar code. VectorMath
+ * evaluates polynomials across all lanes at once, within a few ulp of libm.
+ */
+
+template <class T> struct PackLaneInt;
+template <> struct PackLaneInt<double> { typedef int64_t type; };
+template <> struct PackLaneInt<float> { typedef int32_t type; };
+
+/**
+ * Per lane boolean result of a comparison, all ones or all zeros in an
+ * integer lane the width of T
+ */
+template <class T, int W>
+class PackMask {
+    public:
+        typedef typename PackLaneInt<T>::type I;
+        typedef I vec_type __attribute__((vector_size(W*sizeof(I)), aligned(sizeof(I))));
+
+        PackMask() {}
+
+        PackMask(bool val) {
+            for (int ll = 0; ll < W; ll++) m_[ll] = val ? -1 : 0;
+        }
+
+        static PackMask fromVec(const vec_type& mm) {
+            PackMask ans;
+            ans.m_ = mm;
+            return ans;
+        }
+
+        bool operator[](int ll) const { return m_[ll] != 0; }
+
+        /**
+         * True if any lane is set
+         */
+        bool any() const {
+            I ans = 0;
+            for (int ll = 0; ll < W; ll++) ans |= m_[ll];
+            return ans != 0;
+        }
+
+        friend PackMask operator|(const PackMask& aa, const PackMask& bb) {
+            return fromVec(aa.m_ | bb.m_);
+        }
+
+        friend PackMask operator&(const PackMask& aa, const PackMask& bb) {
+            return fromVec(aa.m_ & bb.m_);
+        }
+
+        friend PackMask operator^(const PackMask& aa, const PackMask& bb) {
+            return fromVec(aa.m_ ^ bb.m_);
+        }
+
+        friend PackMask operator!(const PackMask& aa) {
+            return fromVec(~aa.m_);
+        }
+
+    public:
+        vec_type m_;
+};
+
+/**
+ * W lanes of T with elementwise operators
+ *
+ * Scalars convert implicitly, so expressions can be copied from scalar code.
+ */
+template <class T, int W>
+class Pack {
+    public:
+        typedef T value_type;
+        typedef PackMask<T, W> mask_type;
+        typedef T vec_type __attribute__((vector_size(W*sizeof(T)), aligned(sizeof(T))));
+        static const int width = W;
+
+        Pack() {}
+
+        Pack(T val) {
+            for (int ll = 0; ll < W; ll++) v_[ll] = val;
+        }
+
+        static Pack fromVec(const vec_type& vv) {
+            Pack ans;
+            ans.v_ = vv;
+            return ans;
+        }
+
+        T& operator[](int ll) { return v_[ll]; }
+        T operator[](int ll) const { return v_[ll]; }
+
+        friend Pack operator+(const Pack& aa, const Pack& bb) {
+            return fromVec(aa.v_ + bb.v_);
+        }
+
+        friend Pack operator-(const Pack& aa, const Pack& bb) {
+            return fromVec(aa.v_ - bb.v_);
+        }
+
+        friend Pack operator*(const Pack& aa, const Pack& bb) {
+            return fromVec(aa.v_ * bb.v_);
+        }
+
+        friend Pack operator/(const Pack& aa, const Pack& bb) {
+            return fromVec(aa.v_ / bb.v_);
+        }
+
+        friend Pack operator-(const Pack& aa) {
+            return fromVec(-aa.v_);
+        }
+
+        friend mask_type operator<(const Pack& aa, const Pack& bb) {
+            return mask_type::fromVec(aa.v_ < bb.v_);
+        }
+
+        friend mask_type operator<=(const Pack& aa, const Pack& bb) {
+            return mask_type::fromVec(aa.v_ <= bb.v_);
+        }
+
+        friend mask_type operator>(const Pack& aa, const Pack& bb) {
+            return mask_type::fromVec(aa.v_ > bb.v_);
+        }
+
+        friend mask_type operator>=(const Pack& aa, const Pack& bb) {
+            return mask_type::fromVec(aa.v_ >= bb.v_);
+        }
+
+        friend mask_type operator==(const Pack& aa, const Pack& bb) {
+            return mask_type::fromVec(aa.v_ == bb.v_);
+        }
+
+        /**
+         * Picks aa where the mask is set and bb elsewhere
+         */
+        friend Pack select(const mask_type& mask, const Pack& aa, const Pack& bb) {
+            return fromVec(mask.m_ ? aa.v_ : bb.v_);
+        }
+
+        friend Pack sqrt(const Pack& aa) {
+            Pack ans;
+            for (int ll = 0; ll < W; ll++) ans.v_[ll] = std::sqrt(aa.v_[ll]);
+            return ans;
+        }
+
+        friend Pack fabs(const Pack& aa) {
+            Pack ans;
+            for (int ll = 0; ll < W; ll++) ans.v_[ll] = std::fabs(aa.v_[ll]);
+            return ans;
+        }
+
+        /**
+         * Rounds down to an integer, adding and subtracting 2^52 (2^23 for
+         * float) so the rounding happens in vector registers
+         */
+        friend Pack floor(const Pack& aa) {
+            const T shift = (sizeof(T) == 8) ? 4503599627370496.0 : 8388608.0;
+            Pack pos = (aa + shift) - shift;
+            Pack neg = (aa - shift) + shift;
+            Pack near = select(aa < T(0), neg, pos);
+            near = select(fabs(aa) < shift, near, aa);
+            return select(aa < near, near - T(1), near);
+        }
+
+        /**
+         * Rounds towards zero to an integer
+         */
+        friend Pack trunc(const Pack& aa) {
+            return select(aa < T(0), -floor(-aa), floor(aa));
+        }
+
+    public:
+        vec_type v_;
+};
+
+/**
+ * Transcendentals through libm one lane at a time
+ *
+ * Slow, but bit-identical to the scalar libm calls they replace.
+ */
+struct ScalarMath {
+    template <class T, int W>
+    static Pack<T, W> sin(const Pack<T, W>& aa) {
+        Pack<T, W> ans;
+        for (int ll = 0; ll < W; ll++) ans[ll] = std::sin(aa[ll]);
+        return ans;
+    }
+
+    template <class T, int W>
+    static Pack<T, W> cos(const Pack<T, W>& aa) {
+        Pack<T, W> ans;
+        for (int ll = 0; ll < W; ll++) ans[ll] = std::cos(aa[ll]);
+        return ans;
+    }
+
+    template <class T, int W>
+    static void sincos(const Pack<T, W>& aa, Pack<T, W>& ss, Pack<T, W>& cc) {
+        for (int ll = 0; ll < W; ll++) {
+            ss[ll] = std::sin(aa[ll]);
+            cc[ll] = std::cos(aa[ll]);
+        }
+    }
+
+    template <class T, int W>
+    static Pack<T, W> atan2(const Pack<T, W>& yy, const Pack<T, W>& xx) {
+        Pack<T, W> ans;
+        for (int ll = 0; ll < W; ll++) ans[ll] = std::atan2(yy[ll], xx[ll]);
+        return ans;
+    }
+
+    template <class T, int W>
+    static Pack<T, W> fmod(const Pack<T, W>& aa, T bb) {
+        Pack<T, W> ans;
+        for (int ll = 0; ll < W; ll++) ans[ll] = std::fmod(aa[ll], bb);
+        return ans;
+    }
+
+    /**
+     * aa^1.5
+     */
+    template <class T, int W>
+    static Pack<T, W> powThreeHalves(const Pack<T, W>& aa) {
+        Pack<T, W> ans;
+        for (int ll = 0; ll < W; ll++) ans[ll] = std::pow(aa[ll], T(1.5));
+        return ans;
+    }
+};
+
+/**
+ * Polynomial kernels for VectorMath, from the Cephes library
+ *
+ * reduce takes |x| to [-pi/4, pi/4] given the even octant yy, sinPoly and
+ * cosPoly evaluate there, and atan takes a non negative argument. Arguments
+ * beyond reductionLimit() lose accuracy in the reduction.
+ */
+template <class T> struct VectorMathKernels;
+
+template <> struct VectorMathKernels<double> {
+    static double reductionLimit() { return 1.073741824e9; }
+
+    template <int W>
+    static Pack<double, W> reduce(const Pack<double, W>& xx, const Pack<double, W>& yy) {
+        return ((xx - yy*7.85398125648498535156e-1) - yy*3.77489470793079817668e-8) - yy*2.69515142907905952645e-15;
+    }
+
+    template <int W>
+    static Pack<double, W> sinPoly(const Pack<double, W>& zz, const Pack<double, W>& z2) {
+        Pack<double, W> pp = 1.58962301576546568060e-10*z2 - 2.50507477628578072866e-8;
+        pp = pp*z2 + 2.75573136213857245213e-6;
+        pp = pp*z2 - 1.98412698295895385996e-4;
+        pp = pp*z2 + 8.33333333332211858878e-3;
+        pp = pp*z2 - 1.66666666666666307295e-1;
+        return zz + zz*z2*pp;
+    }
+
+    template <int W>
+    static Pack<double, W> cosPoly(const Pack<double, W>& z2) {
+        Pack<double, W> pp = -1.13585365213876817300e-11*z2 + 2.08757008419747316778e-9;
+        pp = pp*z2 - 2.75573141792967388112e-7;
+        pp = pp*z2 + 2.48015872888517045348e-5;
+        pp = pp*z2 - 1.38888888888730564116e-3;
+        pp = pp*z2 + 4.16666666666665929218e-2;
+        return 1.0 - 0.5*z2 + z2*z2*pp;
+    }
+
+    template <int W>
+    static Pack<double, W> atan(const Pack<double, W>& xx) {
+        typedef Pack<double, W> P;
+        const double morebits = 6.123233995736765886130e-17;
+        typename P::mask_type big = xx > 2.41421356237309504880;
+        typename P::mask_type mid = (!big) & (xx > 0.66);
+        P x1 = select(big, -1.0/xx, select(mid, (xx - 1.0)/(xx + 1.0), xx));
+        P base = select(big, P(1.57079632679489661923), select(mid, P(7.85398163397448309616e-1), P(0.0)));
+        P more = select(big, P(morebits), select(mid, P(0.5*morebits), P(0.0)));
+
+        P zz = x1*x1;
+        P num = -8.750608600031904122785e-1*zz - 1.615753718733365076637e1;
+        num = num*zz - 7.500855792314704667340e1;
+        num = num*zz - 1.228866684490136173410e2;
+        num = num*zz - 6.485021904942025371773e1;
+        P den = zz + 2.485846490142306297962e1;
+        den = den*zz + 1.650270098316988542046e2;
+        den = den*zz + 4.328810604912902668951e2;
+        den = den*zz + 4.853903996359136964868e2;
+        den = den*zz + 1.945506571482613964425e2;
+        return base + ((x1*(zz*num/den) + x1) + more);
+    }
+};
+
+template <> struct VectorMathKernels<float> {
+    static float reductionLimit() { return 8192.0f; }
+
+    template <int W>
+    static Pack<float, W> reduce(const Pack<float, W>& xx, const Pack<float, W>& yy) {
+        return ((xx - yy*0.78515625f) - yy*2.4187564849853515625e-4f) - yy*3.77489497744594108e-8f;
+    }
+
+    template <int W>
+    static Pack<float, W> sinPoly(const Pack<float, W>& zz, const Pack<float, W>& z2) {
+        Pack<float, W> pp = -1.9515295891e-4f*z2 + 8.3321608736e-3f;
+        pp = pp*z2 - 1.6666654611e-1f;
+        return zz + zz*z2*pp;
+    }
+
+    template <int W>
+    static Pack<float, W> cosPoly(const Pack<float, W>& z2) {
+        Pack<float, W> pp = 2.443315711809948e-5f*z2 - 1.388731625493765e-3f;
+        pp = pp*z2 + 4.166664568298827e-2f;
+        return 1.0f - 0.5f*z2 + z2*z2*pp;
+    }
+
+    template <int W>
+    static Pack<float, W> atan(const Pack<float, W>& xx) {
+        typedef Pack<float, W> P;
+        typename P::mask_type big = xx > 2.414213562373095f;
+        typename P::mask_type mid = (!big) & (xx > 0.4142135623730950f);
+        P x1 = select(big, -1.0f/xx, select(mid, (xx - 1.0f)/(xx + 1.0f), xx));
+        P base = select(big, P(1.5707963267948966f), select(mid, P(0.7853981633974483f), P(0.0f)));
+
+        P zz = x1*x1;
+        P pp = 8.05374449538e-2f*zz - 1.38776856032e-1f;
+        pp = pp*zz + 1.99777106478e-1f;
+        pp = pp*zz - 3.33329491539e-1f;
+        return base + (pp*zz*x1 + x1);
+    }
+};
+
+/**
+ * Transcendentals evaluated across all lanes at once
+ *
+ * Within a few ulp of libm for double and float. Lanes whose sine or cosine
+ * argument is beyond the kernel's reduction range go through libm instead.
+ */
+struct VectorMath {
+    template <class T, int W>
+    static Pack<T, W> sin(const Pack<T, W>& aa) {
+        Pack<T, W> ss, cc;
+        sincos(aa, ss, cc);
+        return ss;
+    }
+
+    template <class T, int W>
+    static Pack<T, W> cos(const Pack<T, W>& aa) {
+        Pack<T, W> ss, cc;
+        sincos(aa, ss, cc);
+        return cc;
+    }
+
+    template <class T, int W>
+    static void sincos(const Pack<T, W>& aa, Pack<T, W>& ss, Pack<T, W>& cc) {
+        typedef Pack<T, W> P;
+        typedef typename P::mask_type M;
+        typedef VectorMathKernels<T> K;
+
+        // Octant rounded up to even, then |x| less that many quarter turns
+        P xx = fabs(aa);
+        P yy = floor(xx*T(1.27323954473516268615));
+        yy = yy + (yy - 2.0*floor(0.5*yy));
+        P zz = K::reduce(xx, yy);
+        P z2 = zz*zz;
+        P sn = K::sinPoly(zz, z2);
+        P cs = K::cosPoly(z2);
+
+        P oct = yy - 8.0*floor(0.125*yy);
+        M swap = (oct == T(2)) | (oct == T(6));
+        ss = select(swap, cs, sn);
+        cc = select(swap, sn, cs);
+        ss = select((oct >= T(4)) ^ (aa < T(0)), -ss, ss);
+        cc = select((oct == T(2)) | (oct == T(4)), -cc, cc);
+
+        M big = !(xx <= K::reductionLimit());
+        if (big.any()) {
+            for (int ll = 0; ll < W; ll++) {
+                if (!big[ll]) continue;
+                ss[ll] = std::sin(aa[ll]);
+                cc[ll] = std::cos(aa[ll]);
+            }
+        }
+    }
+
+    template <class T, int W>
+    static Pack<T, W> atan2(const Pack<T, W>& yy, const Pack<T, W>& xx) {
+        typedef Pack<T, W> P;
+        const T halfTurn = 3.14159265358979323846;
+        P tt = yy/xx;
+        P ans = VectorMathKernels<T>::atan(fabs(tt));
+        ans = select(tt < T(0), -ans, ans);
+        ans = select(xx < T(0), ans + select(yy < T(0), P(-halfTurn), P(halfTurn)), ans);
+        return select((xx == T(0)) & (yy == T(0)), P(0), ans);
+    }
+
+    /**
+     * Remainder of aa/bb, exact in libm but here within an ulp of aa
+     */
+    template <class T, int W>
+    static Pack<T, W> fmod(const Pack<T, W>& aa, T bb) {
+        return aa - trunc(aa/bb)*bb;
+    }
+
+    /**
+     * aa^1.5, within an ulp of pow
+     */
+    template <class T, int W>
+    static Pack<T, W> powThreeHalves(const Pack<T, W>& aa) {
+        return aa*sqrt(aa);
+    }
+};
+
+#endif
@@ -1,6 +1,11 @@
 #ifndef ASTRO_STRING_EXTRA_H
 #define ASTRO_STRING_EXTRA_H
 
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -21,4 +26,158 @@ std::vector<std::string> strSplit(const std::string& str, char delim) {
     return vals;
 }
 
+/**
+ * Reads a decimal number from a buffer that isn't null terminated
+ *
+ * Leading spaces and tabs are skipped. Plain decimals whose digits form an
+ * integer of at most 2^53, with up to 22 of them after the point, are exact
+ * as a double over a power of ten, so one division rounds them correctly.
+ * Anything else goes through strtod. Either way the result is the correctly
+ * rounded value, the same strtod or sscanf give.
+ *
+ * @param Start of the text
+ * @param End of the buffer
+ * @param Output value
+ *
+ * @return Pointer just past the number, NULL if there wasn't one
+ */
+inline const char* scanDouble(const char* pos, const char* end, double* val) {
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    while (pos < end && (*pos == ' ' || *pos == '\t')) pos++;
+    const char* start = pos;
+
+    bool negative = false;
+    if (pos < end && (*pos == '-' || *pos == '+')) {
+        negative = (*pos == '-');
+        pos++;
+    }
+
+    // Digits as one integer, it only matters that it is exact when small
+    uint64_t mant = 0;
+    int nread = 0, ndigits = 0, nfrac = 0;
+    while (pos < end && *pos >= '0' && *pos <= '9') {
+        mant = mant*10 + (*pos++ - '0');
+        if (mant != 0) ndigits++;
+        nread++;
+    }
+    if (pos < end && *pos == '.') {
+        pos++;
+        while (pos < end && *pos >= '0' && *pos <= '9') {
+            mant = mant*10 + (*pos++ - '0');
+            if (mant != 0) ndigits++;
+            nread++;
+            nfrac++;
+        }
+    }
+
+    bool plain = (pos == end || *pos == ' ' || *pos == '\t' || *pos == '\n' || *pos == '\r');
+    if (plain) {
+        if (nread == 0) return NULL;
+        if (ndigits <= 19 && mant <= (UINT64_C(1) << 53) && nfrac <= 22) {
+            double value = (double)mant / pow10[nfrac];
+            *val = negative ? -value : value;
+            return pos;
+        }
+    }
+
+    // Exponents, long mantissas, inf and nan
+    char buf[64];
+    const char* tok = start;
+    while (tok < end && tok - start < 63 && *tok != ' ' && *tok != '\t' && *tok != '\n' && *tok != '\r') tok++;
+    memcpy(buf, start, tok - start);
+    buf[tok - start] = '\0';
+    char* stop;
+    *val = strtod(buf, &stop);
+    if (stop == buf) return NULL;
+    return start + (stop - buf);
+}
+
+/**
+ * Formats a double like printf's "%.*f", without going through printf
+ *
+ * The binary value is scaled by the power of ten exactly in 128 bit integer
+ * arithmetic and rounded half to even, the way glibc rounds, so the text is
+ * byte-identical to snprintf's. Values too large for that, inf and nan fall
+ * back to snprintf.
+ *
+ * @param Output buffer, with room for 350 characters
+ * @param Value to format
+ * @param Digits after the decimal point, up to 19
+ *
+ * @return Number of characters written, no terminating null is added
+ */
+inline int formatFixed(char* out, double val, int prec) {
+    static const uint64_t pow10[] = {
+        UINT64_C(1), UINT64_C(10), UINT64_C(100), UINT64_C(1000), UINT64_C(10000),
+        UINT64_C(100000), UINT64_C(1000000), UINT64_C(10000000), UINT64_C(100000000),
+        UINT64_C(1000000000), UINT64_C(10000000000), UINT64_C(100000000000),
+        UINT64_C(1000000000000), UINT64_C(10000000000000), UINT64_C(100000000000000),
+        UINT64_C(1000000000000000), UINT64_C(10000000000000000),
+        UINT64_C(100000000000000000), UINT64_C(1000000000000000000),
+        UINT64_C(10000000000000000000)
+    };
+    typedef unsigned __int128 uint128;
+
+    if (prec < 0 || prec > 19 || isnan(val) || isinf(val)) return snprintf(out, 350, "%.*f", prec, val);
+
+    // |val| = mant * 2^shift, mant * 10^prec stays under 2^117
+    int exp;
+    double frac = frexp(fabs(val), &exp);
+    uint64_t mant = (uint64_t)ldexp(frac, 53);
+    int shift = exp - 53;
+    uint128 scaled = (uint128)mant * pow10[prec];
+
+    uint128 qq;
+    if (shift >= 0) {
+        if (shift > 10) return snprintf(out, 350, "%.*f", prec, val);
+        qq = scaled << shift;
+    } else if (-shift >= 128) {
+        qq = 0;
+    } else {
+        int ss = -shift;
+        qq = scaled >> ss;
+        uint128 rem = scaled - (qq << ss);
+        uint128 half = (uint128)1 << (ss - 1);
+        if (rem > half || (rem == half && (qq & 1))) qq++;
+    }
+
+    int len = 0;
+    if (signbit(val)) out[len++] = '-';
+
+    // Integer part, digits come out in reverse. 64 bit division when it fits.
+    char digits[40];
+    int nn = 0;
+    uint64_t fract;
+    if ((qq >> 64) == 0) {
+        uint64_t whole = (uint64_t)qq / pow10[prec];
+        fract = (uint64_t)qq - whole*pow10[prec];
+        do {
+            digits[nn++] = '0' + (int)(whole % 10);
+            whole /= 10;
+        } while (whole != 0);
+    } else {
+        uint128 whole = qq / pow10[prec];
+        fract = (uint64_t)(qq - whole*pow10[prec]);
+        do {
+            digits[nn++] = '0' + (int)(whole % 10);
+            whole /= 10;
+        } while (whole != 0);
+    }
+    while (nn > 0) out[len++] = digits[--nn];
+
+    if (prec > 0) {
+        out[len++] = '.';
+        for (int ii = prec - 1; ii >= 0; ii--) {
+            out[len + ii] = '0' + (int)(fract % 10);
+            fract /= 10;
+        }
+        len += prec;
+    }
+    return len;
+}
+
 #endif
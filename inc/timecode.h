@@ -91,6 +91,38 @@ class Timecode {
             return Timecode(year, month, day, hour, minute, sec);
         }
 
+        /**
+         * Parses a "YYYY-MM-DD::HH:MM:SS.SSS" time string
+         *
+         * Any non numeric characters separate the fields, so the getStr format
+         * and "YYYY:MM:DD::HH:MM::SS.SSS" both parse. Missing time of day
+         * fields are zero.
+         *
+         * @param Time string
+         *
+         * @return Parsed time
+         */
+        static Timecode parseStr(std::string str) {
+            double vals[6] = {0};
+            int nvals = 0;
+            const char* ptr = str.c_str();
+            while (*ptr != '\0' && nvals < 6) {
+                if (*ptr >= '0' && *ptr <= '9') {
+                    char* end;
+                    vals[nvals++] = strtod(ptr, &end);
+                    ptr = end;
+                } else {
+                    ptr++;
+                }
+            }
+            if (nvals < 3) throw "Invalid time string format";
+
+            return Timecode(
+                (int)vals[0], (int)vals[1], (int)vals[2],
+                (int)vals[3], (int)vals[4], vals[5]
+            );
+        }
+
     private:
         void init(int year, int month, int day, int hour, int minutes, double secs) {
             // TODO: Check inputs
@@ -213,6 +245,21 @@ class Timecode {
             return !(aa == bb);
         }
 
+        /**
+         * Gets the whole seconds since 1950, which together with getFract()
+         * gives back this exact time through Timecode(whole, fract)
+         */
+        int getWhole() const {
+            return whole_;
+        }
+
+        /**
+         * Gets the fractional seconds, in [0, 1)
+         */
+        double getFract() const {
+            return fract_;
+        }
+
         static const char* const monthStrs_[];
 
     private:
@@ -225,4 +272,53 @@ const char* const Timecode::monthStrs_[] = {
     "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
 };
 
+/**
+ * Times from tc0 to tc1 at a fixed step
+ *
+ * The last time is always tc1, even when the span is not a whole number of
+ * steps. Times are computed on demand rather than stored.
+ */
+class StepGrid {
+    public:
+        StepGrid(Timecode tc0, Timecode tc1, double step) {
+            if (!(step > 0)) throw "Time step must be positive";
+            tc0_ = tc0;
+            tc1_ = tc1;
+            step_ = step;
+
+            // Count whole steps with the same tc0 + count*step <= tc1 test
+            // used to generate them
+            numWhole_ = 0;
+            size_ = 0;
+            if (tc0 <= tc1) {
+                long nn = (long)floor((tc1 - tc0)/step);
+                while (nn > 0 && !(tc0 + nn*step <= tc1)) nn--;
+                while (tc0 + (nn+1)*step <= tc1) nn++;
+                numWhole_ = nn + 1;
+                size_ = numWhole_;
+                if (tc0 + nn*step < tc1) size_++;
+            }
+        }
+
+        /**
+         * Gets the number of times in the grid
+         */
+        long size() const {
+            return size_;
+        }
+
+        /**
+         * Gets the time at the given index
+         */
+        Timecode operator [](long idx) const {
+            if (idx >= numWhole_) return tc1_;
+            return tc0_ + idx*step_;
+        }
+
+    private:
+        Timecode tc0_, tc1_;
+        double step_;
+        long numWhole_, size_;
+};
+
 #endif
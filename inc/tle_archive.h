@@ -0,0 +1,235 @@
+#ifndef ASTRO_TLE_ARCHIVE_H
+#define ASTRO_TLE_ARCHIVE_H
+
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <unordered_map>
+
+#include "sgp4.h"
+#include "mapped_file.h"
+#include "parallel.h"
+
+/**
+ * Location and key fields of one element set in a TLE archive
+ */
+struct TleRecord {
+    size_t line1_, line2_;     // Offsets of the two element lines
+    int len1_, len2_;          // Line lengths without line endings
+    long satnum_;
+    double epoch_;             // Four digit year*1000 + day of year
+    char intldesg_[9];         // International designator, trimmed
+};
+
+/**
+ * Indexed, memory mapped 2 or 3 line element file
+ *
+ * Opening the archive maps the file and scans it once, in parallel chunks,
+ * recording where each element set is and its key fields. Hash indexes from
+ * NORAD ID and international designator point at the newest element set for
+ * each object, so lookups don't touch the rest of the file. TLE's are only
+ * built from the mapped text when requested.
+ */
+class TleArchive {
+    public:
+        /**
+         * Maps and indexes a TLE file
+         *
+         * @param File to read
+         * @param Number of threads for the scan, zero or less for one per hardware thread
+         */
+        TleArchive(std::string filename, int nthreads = 0) {
+            if (!file_.open(filename)) throw "Unable to open TLE file";
+            scan(nthreads);
+
+            for (int ii = 0; ii < (int)records_.size(); ii++) {
+                const TleRecord& rec = records_[ii];
+                addNewest(bySatnum_, rec.satnum_, ii);
+                if (rec.intldesg_[0] != '\0') addNewest(byIntlDesg_, std::string(rec.intldesg_), ii);
+            }
+        }
+
+        /**
+         * Gets the number of element sets in the file
+         */
+        size_t size() const {
+            return records_.size();
+        }
+
+        /**
+         * Gets the number of distinct NORAD ID's in the file
+         */
+        size_t numSatellites() const {
+            return bySatnum_.size();
+        }
+
+        /**
+         * Gets every NORAD ID in the file in increasing order
+         */
+        std::vector<long> satnums() const {
+            std::vector<long> ids;
+            ids.reserve(bySatnum_.size());
+            for (std::unordered_map<long, int>::const_iterator it = bySatnum_.begin(); it != bySatnum_.end(); ++it) {
+                ids.push_back(it->first);
+            }
+            std::sort(ids.begin(), ids.end());
+            return ids;
+        }
+
+        bool contains(long satnum) const {
+            return bySatnum_.count(satnum) != 0;
+        }
+
+        /**
+         * Gets the newest TLE for a NORAD ID
+         *
+         * @param NORAD ID
+         *
+         * @return TLE with the latest epoch, the later one in the file on ties
+         */
+        TLE get(long satnum) const {
+            std::unordered_map<long, int>::const_iterator it = bySatnum_.find(satnum);
+            if (it == bySatnum_.end()) throw "No TLE found for satid";
+            return getRecord(it->second);
+        }
+
+        /**
+         * Gets the newest TLE for an international designator
+         *
+         * @param Designator as it appears in the TLE, e.g. "98067A"
+         *
+         * @return TLE with the latest epoch, the later one in the file on ties
+         */
+        TLE get(const std::string& intldesg) const {
+            std::unordered_map<std::string, int>::const_iterator it = byIntlDesg_.find(intldesg);
+            if (it == byIntlDesg_.end()) throw "No TLE found for international designator";
+            return getRecord(it->second);
+        }
+
+        /**
+         * Builds the TLE for an element set, in file order
+         *
+         * @param Index of the element set
+         */
+        TLE getRecord(size_t idx) const {
+            const TleRecord& rec = records_[idx];
+            const char* data = file_.data();
+            return TLE(TextSpan(data + rec.line1_, rec.len1_), TextSpan(data + rec.line2_, rec.len2_));
+        }
+
+    private:
+        template <class Key>
+        void addNewest(std::unordered_map<Key, int>& index, const Key& key, int idx) {
+            std::pair<typename std::unordered_map<Key, int>::iterator, bool> ins = index.insert(std::make_pair(key, idx));
+            if (!ins.second && records_[ins.first->second].epoch_ <= records_[idx].epoch_) {
+                ins.first->second = idx;
+            }
+        }
+
+        /**
+         * Finds every element set in the file
+         *
+         * The file is cut into one byte range per worker. Each worker takes the
+         * element sets whose first line starts in its range, so records come
+         * out in file order when the ranges are joined.
+         */
+        void scan(int nthreads) {
+            const char* data = file_.data();
+            size_t size = file_.size();
+            if (size == 0) return;
+
+            long nchunks = numWorkers(nthreads);
+            std::vector<std::vector<TleRecord> > chunks(nchunks);
+            parallelFor(nchunks, nchunks, [&](long begin, long end) {
+                for (long cc = begin; cc < end; cc++) {
+                    size_t pos = size*cc/nchunks;
+                    size_t stop = size*(cc+1)/nchunks;
+
+                    // Start at the first line beginning in the range
+                    if (pos > 0 && data[pos-1] != '\n') pos = nextLine(pos);
+
+                    while (pos < stop) {
+                        size_t pos2 = nextLine(pos);
+                        TleRecord rec;
+                        if (pos2 < size && parseRecord(pos, pos2, rec)) {
+                            chunks[cc].push_back(rec);
+                            pos = nextLine(pos2);
+                        } else {
+                            pos = pos2;
+                        }
+                    }
+                }
+            });
+
+            size_t total = 0;
+            for (long cc = 0; cc < nchunks; cc++) total += chunks[cc].size();
+            records_.reserve(total);
+            for (long cc = 0; cc < nchunks; cc++) {
+                records_.insert(records_.end(), chunks[cc].begin(), chunks[cc].end());
+            }
+        }
+
+        size_t nextLine(size_t pos) const {
+            const char* data = file_.data();
+            size_t size = file_.size();
+            const char* nl = (const char*)memchr(data + pos, '\n', size - pos);
+            return (nl == NULL) ? size : nl - data + 1;
+        }
+
+        int lineLength(size_t pos) const {
+            const char* data = file_.data();
+            size_t end = nextLine(pos);
+            while (end > pos && (data[end-1] == '\n' || data[end-1] == '\r')) end--;
+            return end - pos;
+        }
+
+        /**
+         * Reads the key fields of an element set from its two lines
+         *
+         * @return False if the lines aren't a line 1 and line 2 pair
+         */
+        bool parseRecord(size_t pos1, size_t pos2, TleRecord& rec) const {
+            const char* line1 = file_.data() + pos1;
+            const char* line2 = file_.data() + pos2;
+            rec.len1_ = lineLength(pos1);
+            rec.len2_ = lineLength(pos2);
+            if (rec.len1_ < 69 || rec.len2_ < 69) return false;
+            if (line1[0] != '1' || line1[1] != ' ' || line2[0] != '2' || line2[1] != ' ') return false;
+
+            rec.line1_ = pos1;
+            rec.line2_ = pos2;
+
+            // Columns 3-7, same digits on both lines
+            rec.satnum_ = 0;
+            for (int ii = 2; ii < 7; ii++) {
+                if (line1[ii] >= '0' && line1[ii] <= '9') rec.satnum_ = rec.satnum_*10 + (line1[ii] - '0');
+            }
+
+            // Columns 10-17, without padding
+            int nn = 0;
+            for (int ii = 9; ii < 17; ii++) {
+                if (line1[ii] != ' ') rec.intldesg_[nn++] = line1[ii];
+            }
+            rec.intldesg_[nn] = '\0';
+
+            // Columns 19-20 are the year, 21-32 the day of year
+            char buf[16];
+            memcpy(buf, line1 + 20, 12);
+            buf[12] = '\0';
+            int year = (line1[18] - '0')*10 + (line1[19] - '0');
+            year += (year < 57) ? 2000 : 1900;
+            rec.epoch_ = year*1000.0 + strtod(buf, NULL);
+
+            return true;
+        }
+
+    private:
+        MappedFile file_;
+        std::vector<TleRecord> records_;
+        std::unordered_map<long, int> bySatnum_;
+        std::unordered_map<std::string, int> byIntlDesg_;
+};
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef ASTRO_TLE_PARSE_H
+#define ASTRO_TLE_PARSE_H
+
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+
+#include "vallado_sgp4.h"
+
+/**
+ * Settings used to initialize a TLE's element set
+ */
+struct TleOptions {
+    TleOptions(Vallado::gravconsttype whichconst = Vallado::wgs72, char opsmode = 'a', char typerun = 'c', bool checksum = false) {
+        whichconst_ = whichconst;
+        opsmode_ = opsmode;
+        typerun_ = typerun;
+        checksum_ = checksum;
+    }
+
+    Vallado::gravconsttype whichconst_;
+    char opsmode_;  // 'a' for AFSPC compatible, 'i' for improved
+    char typerun_;  // 'c' for catalog, 'v' to also read verification times from line 2
+    bool checksum_; // Reject lines whose modulo 10 checksum doesn't match
+};
+
+/**
+ * Read only view of a line of text, which doesn't need to be null terminated
+ */
+struct TextSpan {
+    TextSpan(const char* data, size_t size) {
+        data_ = data;
+        size_ = size;
+    }
+
+    TextSpan(const char* str) {
+        data_ = str;
+        size_ = strlen(str);
+    }
+
+    TextSpan(const std::string& str) {
+        data_ = str.data();
+        size_ = str.size();
+    }
+
+    const char* data_;
+    size_t size_;
+};
+
+/**
+ * Checks the modulo 10 checksum in column 69 of a TLE line
+ *
+ * Digits count their value and minus signs count one.
+ *
+ * @param Line of at least 69 characters
+ */
+inline bool tleChecksumOk(const char* line) {
+    int sum = 0;
+    for (int ii = 0; ii < 68; ii++) {
+        if (line[ii] >= '0' && line[ii] <= '9') sum += line[ii] - '0';
+        else if (line[ii] == '-') sum++;
+    }
+    return line[68] == '0' + sum % 10;
+}
+
+/**
+ * Reads a fixed column field of a line as a double
+ *
+ * @param Line buffer
+ * @param First column, counting from zero
+ * @param One past the last column
+ */
+inline double tleField(const char* line, int begin, int end) {
+    char buf[32];
+    memcpy(buf, line + begin, end - begin);
+    buf[end - begin] = '\0';
+    return strtod(buf, NULL);
+}
+
+/**
+ * Reads a fixed column field of a line as an integer
+ */
+inline long tleIntField(const char* line, int begin, int end) {
+    char buf[32];
+    memcpy(buf, line + begin, end - begin);
+    buf[end - begin] = '\0';
+    return strtol(buf, NULL, 10);
+}
+
+/**
+ * Parses the two element lines of a TLE and initializes its element set
+ *
+ * Fields are read from their fixed columns of a copy of each line on the
+ * stack, so nothing is allocated and any number of threads can parse at
+ * once. Columns are fixed up and converted just as Vallado::twoline2rv does
+ * with sscanf, which gives identical element sets for well formed lines.
+ *
+ * @param First element line, without line ending
+ * @param Second element line, without line ending
+ * @param Gravity model, operation mode and run type
+ * @param Element set to fill in and initialize with sgp4init
+ * @param Propagation span in minutes from epoch for the run type
+ *
+ * @return NULL on success, otherwise a message saying why the lines were rejected
+ */
+inline const char* parseTLE(
+    TextSpan line1, TextSpan line2, const TleOptions& options, Vallado::elsetrec& satrec,
+    double& startmfe, double& stopmfe, double& deltamin
+) {
+    const double deg2rad = pi / 180.0;
+    const double xpdotp = 1440.0 / (2.0 * pi);
+
+    if (line1.size_ < 69 || line2.size_ < 69) return "TLE line shorter than 69 characters";
+    if (line1.data_[0] != '1' || line2.data_[0] != '2') return "TLE lines must start with 1 and 2";
+    if (options.checksum_ && (!tleChecksumOk(line1.data_) || !tleChecksumOk(line2.data_))) {
+        return "TLE checksum mismatch";
+    }
+
+    // Only line 2's optional verification times run past column 69
+    char str1[70], str2[130];
+    memcpy(str1, line1.data_, 69);
+    str1[69] = '\0';
+    size_t len2 = (line2.size_ < sizeof(str2) - 1) ? line2.size_ : sizeof(str2) - 1;
+    memcpy(str2, line2.data_, len2);
+    str2[len2] = '\0';
+
+    // Implied decimal points and blank fields, as in twoline2rv
+    for (int ii = 10; ii <= 15; ii++) {
+        if (str1[ii] == ' ') str1[ii] = '_';
+    }
+    if (str1[44] != ' ') str1[43] = str1[44];
+    str1[44] = '.';
+    if (str1[7] == ' ') str1[7] = 'U';
+    if (str1[9] == ' ') str1[9] = '.';
+    for (int ii = 45; ii <= 49; ii++) {
+        if (str1[ii] == ' ') str1[ii] = '0';
+    }
+    if (str1[51] == ' ') str1[51] = '0';
+    if (str1[53] != ' ') str1[52] = str1[53];
+    str1[53] = '.';
+    str2[25] = '.';
+    for (int ii = 26; ii <= 32; ii++) {
+        if (str2[ii] == ' ') str2[ii] = '0';
+    }
+    if (str1[62] == ' ') str1[62] = '0';
+    if (str1[68] == ' ') str1[68] = '0';
+
+    satrec.error = 0;
+
+    // Line 1
+    satrec.classification = str1[7];
+    int nn = 0;
+    for (int ii = 9; ii < 19 && str1[ii] != ' '; ii++) satrec.intldesg[nn++] = str1[ii];
+    satrec.intldesg[nn] = '\0';
+    satrec.epochyr = tleIntField(str1, 18, 20);
+    satrec.epochdays = tleField(str1, 20, 32);
+    satrec.ndot = tleField(str1, 33, 43);
+    satrec.nddot = tleField(str1, 43, 50);
+    int nexp = tleIntField(str1, 50, 52);
+    satrec.bstar = tleField(str1, 52, 59);
+    int ibexp = tleIntField(str1, 59, 61);
+    satrec.ephtype = tleIntField(str1, 62, 64);
+    satrec.elnum = tleIntField(str1, 63, 69);
+
+    // Line 2, where revnum runs into the checksum like sscanf's %6ld does
+    satrec.satnum = tleIntField(str2, 2, 7);
+    satrec.inclo = tleField(str2, 8, 16);
+    satrec.nodeo = tleField(str2, 17, 25);
+    satrec.ecco = tleField(str2, 25, 33);
+    satrec.argpo = tleField(str2, 34, 42);
+    satrec.mo = tleField(str2, 43, 51);
+    satrec.no_kozai = tleField(str2, 52, 63);
+    satrec.revnum = tleIntField(str2, 63, 69);
+
+    if (options.typerun_ == 'v') {
+        char* pos = str2 + 69;
+        startmfe = strtod(pos, &pos);
+        stopmfe = strtod(pos, &pos);
+        deltamin = strtod(pos, &pos);
+    } else {
+        startmfe = -1440.0;
+        stopmfe = 1440.0;
+        deltamin = 10.0;
+    }
+
+    // Convert to sgp4 units
+    satrec.no_kozai = satrec.no_kozai / xpdotp;
+    satrec.nddot = satrec.nddot * pow(10.0, nexp);
+    satrec.bstar = satrec.bstar * pow(10.0, ibexp);
+    satrec.ndot = satrec.ndot / (xpdotp*1440.0);
+    satrec.nddot = satrec.nddot / (xpdotp*1440.0 * 1440);
+    satrec.inclo = satrec.inclo * deg2rad;
+    satrec.nodeo = satrec.nodeo * deg2rad;
+    satrec.argpo = satrec.argpo * deg2rad;
+    satrec.mo = satrec.mo * deg2rad;
+
+    // Epoch, two digit years are 1957-2056
+    int year = (satrec.epochyr < 57) ? satrec.epochyr + 2000 : satrec.epochyr + 1900;
+    int mon, day, hr, minute;
+    double sec;
+    Vallado::days2mdhms(year, satrec.epochdays, mon, day, hr, minute, sec);
+    Vallado::jday(year, mon, day, hr, minute, sec, satrec.jdsatepoch, satrec.jdsatepochF);
+
+    Vallado::sgp4init(
+        options.whichconst_, options.opsmode_, satrec.satnum,
+        (satrec.jdsatepoch + satrec.jdsatepochF) - 2433281.5, satrec.bstar,
+        satrec.ndot, satrec.nddot, satrec.ecco, satrec.argpo, satrec.inclo,
+        satrec.mo, satrec.no_kozai, satrec.nodeo, satrec
+    );
+
+    return NULL;
+}
+
+#endif
@@ -2,7 +2,7 @@
 using namespace std;
 
 #include "cmdline.h"
-#include "io_ephemeris.h"
+#include "compressed_ephemeris.h"
 
 int main(int argc, const char* argv[]) {
     try {
@@ -10,8 +10,8 @@ int main(int argc, const char* argv[]) {
             "Computes the RIC difference between two ephemeris files\n"
 
             "_Parameters\n"
-            "  <ephem0> - Ephemeris file 0\n"
-            "  <ephem1> - Ephemeris file 0\n"
+            "  <ephem0> - Ephemeris file 0, AGI, binary or compressed\n"
+            "  <ephem1> - Ephemeris file 1, AGI, binary or compressed\n"
             "  <outfile> - Output file for ric text output\n"
         );
 
@@ -19,8 +19,8 @@ int main(int argc, const char* argv[]) {
         std::string ephem1_file = argv[2];
         std::string outfile     = argv[3];
 
-        Ephemeris ephem0 = readEphemAGI(ephem0_file);
-        Ephemeris ephem1 = readEphemAGI(ephem1_file);
+        Ephemeris ephem0 = readEphemFile(ephem0_file);
+        Ephemeris ephem1 = readEphemFile(ephem1_file);
 
         vector<StateVec> ric = ephem0.RIC(ephem1);
 
@@ -1,10 +1,21 @@
 #include <iostream>
+#include <set>
 
 using namespace std;
 
 #include "cmdline.h"
 #include "ephem_gen.h"
-#include "io_ephemeris.h"
+#include "compressed_ephemeris.h"
+#include "tle_archive.h"
+
+/**
+ * Writes an ephemeris in the format picked on the command line
+ */
+bool writeEphem(std::string outfile, const Ephemeris& ephem, bool binary, bool compress, int nthreads) {
+    if (binary) return writeEphemToBinary(outfile, ephem);
+    if (compress) return writeEphemCompressed(outfile, ephem, EphemCodecOptions(), nthreads);
+    return writeEphemToAGI(outfile, ephem, nthreads);
+}
 
 int main(int argc, const char* argv[]) {
     try {
@@ -13,13 +24,90 @@ int main(int argc, const char* argv[]) {
 
             "_Parameters\n"
             "  <tlefile> - File with TLE(s) in it\n"
-            "  <outfile> - Output ephemeris file\n"
+            "  <outfile> - Output ephemeris file, or prefix for \"<outfile>_<satid>.e\" files with more than one satellite\n"
             "  <starttime> - Time to start ephemeris at \"YYYY:MM:DD::HH:MM::SS.SSS\"\n"
             "  <stoptime>  - Time to stop ephemeris at \"YYYY:MM:DD::HH:MM::SS.SSS\"\n"
             "_Options\n"
-            "  --satid - Satellite ID to get matching TLE for (Defaults to first TLE in file)\n"
+            "  --satid=      - Comma separated satellite ID(s) to get the newest matching TLE for (Defaults to first TLE in file)\n"
+            "  --all/-a      - Generate an ephemeris for every satellite in the file\n"
+            "  --step=       - Time step in seconds (Defaults to 60)\n"
+            "  --threads/-j= - Number of worker threads (Defaults to one per core)\n"
+            "  --binary/-b   - Write binary ephemeris files, named \"<outfile>_<satid>.beph\" with more than one satellite\n"
+            "  --compress/-z - Write compressed ephemeris files, named \"<outfile>_<satid>.ceph\" with more than one satellite\n"
         );
-                    
+
+        std::string tlefile = argv[1];
+        std::string outfile = argv[2];
+        Timecode tc0 = Timecode::parseStr(argv[3]);
+        Timecode tc1 = Timecode::parseStr(argv[4]);
+        double step = args.optflt("--step", 60);
+        int nthreads = args.optint("--threads", 0);
+        bool all = args.optset("--all");
+        bool binary = args.optset("--binary");
+        bool compress = args.optset("--compress");
+        if (binary && compress) throw "Only one of --binary and --compress can be given";
+        std::string satids = args.optval("--satid", "");
+        bool multiple = all || satids.find(',') != std::string::npos;
+
+        TleArchive archive(tlefile, nthreads);
+        if (archive.size() == 0) throw "No TLE's found in file";
+
+        std::vector<TLE> tles;
+        if (all) {
+            std::vector<long> ids = archive.satnums();
+            for (int ii = 0; ii < (int)ids.size(); ii++) tles.push_back(archive.get(ids[ii]));
+        } else if (satids != "") {
+            // Repeated ids would have two workers writing the same file
+            std::vector<std::string> ids = strSplit(satids, ',');
+            std::set<long> seen;
+            for (int ii = 0; ii < (int)ids.size(); ii++) {
+                long satnum = atol(ids[ii].c_str());
+                if (!seen.insert(satnum).second) continue;
+                if (!archive.contains(satnum)) {
+                    cout << "No TLE found for satid " << satnum << endl;
+                    continue;
+                }
+                tles.push_back(archive.get(satnum));
+            }
+        } else {
+            tles.push_back(archive.getRecord(0));
+        }
+
+        // A single satellite gets every worker for its propagation, otherwise
+        // each worker generates and writes whole ephemerides. Every file is
+        // produced by one worker, so contents don't depend on scheduling.
+        if (!multiple) {
+            if (tles.size() == 0) return 0;
+            Ephemeris ephem = ephemFromTLE(tles[0], tc0, tc1, step, nthreads);
+            if (!writeEphem(outfile, ephem, binary, compress, nthreads)) throw "Unable to write ephemeris file";
+            return 0;
+        }
+
+        // A satellite that fails only loses its own file, the rest of its
+        // worker's range still gets written
+        std::vector<const char*> errors(tles.size(), (const char*)NULL);
+        parallelFor(tles.size(), nthreads, [&](long begin, long end) {
+            for (long ii = begin; ii < end; ii++) {
+                const TLE& tle = tles[ii];
+                try {
+                    Ephemeris ephem = ephemFromTLE(tle, tc0, tc1, step);
+                    char name[32];
+                    snprintf(name, sizeof(name), binary ? "_%ld.beph" : compress ? "_%ld.ceph" : "_%ld.e", tle.satrec_.satnum);
+                    if (!writeEphem(outfile + name, ephem, binary, compress, 1)) errors[ii] = "Unable to write file";
+                } catch (const char* ee) {
+                    errors[ii] = ee;
+                } catch (...) {
+                    errors[ii] = "Unexpected error";
+                }
+            }
+        });
+
+        for (int ii = 0; ii < (int)tles.size(); ii++) {
+            if (errors[ii] != NULL) {
+                cout << "Unable to write ephemeris for satid " << tles[ii].satrec_.satnum << ": " << errors[ii] << endl;
+            }
+        }
+
     } catch(const char* ee) {
         cout << ee << endl;
     }
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <stdio.h>
+#include <stddef.h>
+using namespace std;
+
+#include "ephem_gen.h"
+#include "binary_ephemeris.h"
+
+/**
+ * Largest difference of any state vector between an ephemeris and a view
+ * interpolated at the given times, or -1 if they throw for different times
+ */
+double maxStateDiff(const Ephemeris& ephem, const EphemerisView& view, const vector<Timecode>& times, int numpts) {
+    Ephemeris::Cursor cursor0(ephem);
+    EphemerisView::Cursor cursor1(view);
+    double maxdiff = 0;
+    for (int ii = 0; ii < (int)times.size(); ii++) {
+        StateVec sv0, sv1;
+        bool ok0 = true, ok1 = true;
+        try { sv0 = cursor0.getSV(times[ii], numpts); } catch (const char* ee) { ok0 = false; }
+        try { sv1 = cursor1.getSV(times[ii], numpts); } catch (const char* ee) { ok1 = false; }
+        if (ok0 != ok1) return -1;
+        if (!ok0) continue;
+        maxdiff = fmax(maxdiff, (sv0.pos_ - sv1.pos_).mag());
+        maxdiff = fmax(maxdiff, (sv0.vel_ - sv1.vel_).mag());
+        maxdiff = fmax(maxdiff, (sv0.acc_ - sv1.acc_).mag());
+    }
+    return maxdiff;
+}
+
+int main(int argc, char* argv[]) {
+    string str1 = "1 28868U 05036A   17189.60254437 -.00000076 +00000-0 +00000-0 0  9997";
+    string str2 = "2 28868 000.0215 332.1778 0003279 099.8260 324.3314 01.00271962013763";
+    TLE tle = TLE(str1, str2);
+    Ephemeris ephem = ephemFromTLE(tle, tle.epoch_ + 0.25, tle.epoch_ + 86400.25, 60);
+    ephem.csystem_ = TEME;
+    ephem.csystemEpoch_ = tle.epoch_;
+
+    if (!writeEphemToBinary("tmp.beph", ephem)) cout << "Unable to write tmp.beph" << endl;
+    EphemerisView view("tmp.beph");
+    cout << "states = " << view.numStates() << " == " << ephem.states_.size() << endl;
+    cout << "step = " << view.step() << " == 60" << endl;
+    cout << "csystem = " << view.csystem_ << " epoch diff = " << (view.csystemEpoch_ - tle.epoch_) << " == 0" << endl;
+
+    // Round trip through the file is exact
+    Ephemeris copy = view.toEphemeris(4);
+    int mismatches = 0;
+    for (int ii = 0; ii < (int)ephem.states_.size(); ii++) {
+        const StateVec& sv0 = ephem.states_[ii];
+        const StateVec& sv1 = copy.states_[ii];
+        if (sv0.tc_.getWhole() != sv1.tc_.getWhole() || sv0.tc_.getFract() != sv1.tc_.getFract()) mismatches++;
+        for (int kk = 0; kk < 3; kk++) {
+            if (sv0.pos_[kk] != sv1.pos_[kk] || sv0.vel_[kk] != sv1.vel_[kk]) mismatches++;
+        }
+    }
+    cout << "round trip mismatches = " << mismatches << " == 0" << endl;
+
+    // Interpolating the view matches the ephemeris, in and out of span
+    vector<Timecode> times;
+    for (double tt = -100; tt < 86500; tt += 37.3) {
+        times.push_back(tle.epoch_ + tt);
+    }
+    cout << "lagrange view vs ephemeris max diff = " << maxStateDiff(ephem, view, times, 8) << " == 0" << endl;
+
+    // Lookups from the step agree with searching, including at sample times
+    for (int ii = 0; ii < (int)ephem.states_.size(); ii += 97) times.push_back(ephem.states_[ii].tc_);
+    int boundMismatches = 0;
+    for (int ii = 0; ii < (int)times.size(); ii++) {
+        if (sampleLowerBound(view, times[ii]) != sampleLowerBound<EphemerisView>(view, times[ii])) boundMismatches++;
+    }
+    cout << "step lookup mismatches = " << boundMismatches << " == 0" << endl;
+    StateVec sv = view.getSV(tle.epoch_ + 43210.5);
+    cout << sv.pos_.x_ << " " << sv.pos_.y_ << " " << sv.pos_.z_ << endl;
+
+    // Hermite with accelerations on an unevenly spaced ephemeris
+    Ephemeris uneven;
+    uneven.interpMethod_ = HERMITE;
+    uneven.accValid_ = true;
+    for (int ii = 0; ii < (int)ephem.states_.size(); ii += 1 + ii % 3) {
+        StateVec sv = ephem.states_[ii];
+        sv.acc_ = sv.pos_*(-3.986004418e5/pow(sv.pos_.mag(), 3));
+        uneven.states_.push_back(sv);
+    }
+    writeEphemToBinary("tmp.beph", uneven);
+    EphemerisView view1("tmp.beph");
+    cout << "uneven step = " << view1.step() << " == 0, acc = " << view1.accValid_ << endl;
+    cout << "hermite view vs ephemeris max diff = " << maxStateDiff(uneven, view1, times, 4) << " == 0" << endl;
+
+    // Files are told apart by their contents
+    writeEphemToAGI("tmp.e", ephem);
+    cout << "binary magic = " << isBinaryEphemFile("tmp.beph") << " " << isBinaryEphemFile("tmp.e") << endl;
+
+    try {
+        EphemerisView bad("tmp.e");
+    } catch (const char* ee) {
+        cout << ee << endl;
+    }
+
+    // Header fields the reader doesn't know are rejected
+    FILE* fp = fopen("tmp.beph", "r+b");
+    int32_t method = 7;
+    fseek(fp, offsetof(BinaryEphemHeader, interpMethod_), SEEK_SET);
+    fwrite(&method, sizeof(method), 1, fp);
+    fclose(fp);
+    try {
+        EphemerisView bad("tmp.beph");
+    } catch (const char* ee) {
+        cout << ee << endl;
+    }
+    writeEphemToBinary("tmp.beph", uneven);
+
+    fp = fopen("tmp.beph", "r+b");
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    if (truncate("tmp.beph", size - 8) != 0) cout << "Unable to truncate tmp.beph" << endl;
+    try {
+        EphemerisView bad("tmp.beph");
+    } catch (const char* ee) {
+        cout << ee << endl;
+    }
+
+    return 0;
+}
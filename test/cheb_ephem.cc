@@ -0,0 +1,39 @@
+#include <iostream>
+using namespace std;
+
+#include "ephem_gen.h"
+#include "chebyshev_ephemeris.h"
+
+int main(int argc, char* argv[]) {
+    string str1 = "1 28868U 05036A   17189.60254437 -.00000076 +00000-0 +00000-0 0  9997";
+    string str2 = "2 28868 000.0215 332.1778 0003279 099.8260 324.3314 01.00271962013763";
+    TLE tle = TLE(str1, str2);
+    Ephemeris ephem = ephemFromTLE(tle, tle.epoch_, tle.epoch_ + 86400, 60);
+
+    ChebyshevEphemeris cheb(ephem, 4*3600.0, 12);
+    cout << "segments = " << cheb.numSegs_ << endl;
+    cout << "doubles stored = " << cheb.numCoeffs() << " vs " << 6*ephem.states_.size() << endl;
+
+    double maxpos = 0, maxvel = 0;
+    for (double tt = 0; tt <= 86400; tt += 37) {
+        StateVec sv0 = cheb.getSV(tle.epoch_ + tt);
+        StateVec sv1 = ephem.getSV(tle.epoch_ + tt, 8);
+        maxpos = fmax(maxpos, (sv0.pos_ - sv1.pos_).mag());
+        maxvel = fmax(maxvel, (sv0.vel_ - sv1.vel_).mag());
+    }
+    cout << "max pos diff = " << maxpos << " m" << endl;
+    // Velocity is the derivative of the position fit, which SGP4 output
+    // velocities only agree with to ~0.1 m/s
+    cout << "max vel diff = " << maxvel << " m/s" << endl;
+
+    cout << cheb.getSV(tle.epoch_ + 86400).getStr() << endl;
+    cout << ephem.states_.back().getStr() << endl;
+
+    try {
+        cheb.getSV(tle.epoch_ + 86401);
+    } catch (const char* ee) {
+        cout << ee << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,145 @@
+#include <iostream>
+#include <stdio.h>
+#include <float.h>
+using namespace std;
+
+#include "ephem_gen.h"
+#include "compressed_ephemeris.h"
+
+long fileSize(string filename) {
+    FILE* fp = fopen(filename.c_str(), "rb");
+    if (fp == NULL) return -1;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fclose(fp);
+    return size;
+}
+
+/**
+ * Counts decoded values further than half a quantum from the original,
+ * allowing for rounding to the nearest double
+ */
+int boundViolations(const Ephemeris& ephem, const Ephemeris& decoded, const EphemCodecOptions& options) {
+    int count = 0;
+    for (int ii = 0; ii < (int)ephem.states_.size(); ii++) {
+        const StateVec& sv0 = ephem.states_[ii];
+        const StateVec& sv1 = decoded.states_[ii];
+        if (fabs(sv1.tc_ - sv0.tc_) > 0.5/options.ticksPerSecond_ + 1e-12) count++;
+        for (int kk = 0; kk < 3; kk++) {
+            if (fabs(sv1.pos_[kk] - sv0.pos_[kk]) > 0.5*options.posQuantum_ + 4*DBL_EPSILON*fabs(sv0.pos_[kk])) count++;
+            if (fabs(sv1.vel_[kk] - sv0.vel_[kk]) > 0.5*options.velQuantum_ + 4*DBL_EPSILON*fabs(sv0.vel_[kk])) count++;
+            if (ephem.accValid_ && fabs(sv1.acc_[kk] - sv0.acc_[kk]) > 0.5*options.accQuantum_ + 4*DBL_EPSILON*fabs(sv0.acc_[kk])) count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Largest state difference between a compressed ephemeris and its decoded
+ * copy interpolated at the given times
+ */
+double maxStateDiff(const CompressedEphemeris& compressed, const Ephemeris& ephem, const vector<Timecode>& times) {
+    CompressedEphemeris::Cursor cursor0(compressed);
+    Ephemeris::Cursor cursor1(ephem);
+    double maxdiff = 0;
+    for (int ii = 0; ii < (int)times.size(); ii++) {
+        StateVec sv0 = cursor0.getSV(times[ii], 8);
+        StateVec sv1 = cursor1.getSV(times[ii], 8);
+        maxdiff = fmax(maxdiff, (sv0.pos_ - sv1.pos_).mag());
+        maxdiff = fmax(maxdiff, (sv0.vel_ - sv1.vel_).mag());
+        maxdiff = fmax(maxdiff, (sv0.acc_ - sv1.acc_).mag());
+    }
+    return maxdiff;
+}
+
+int main(int argc, char* argv[]) {
+    string str1 = "1 25544U 98067A   17211.50000000  .00002182  00000-0  40768-4 0  9990";
+    string str2 = "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563537";
+    TLE tle(str1, str2);
+
+    // Sizes and error bounds for a low orbit at a few time steps
+    double steps[] = {60, 10, 1};
+    for (int ss = 0; ss < 3; ss++) {
+        Ephemeris ephem = ephemFromTLE(tle, tle.epoch_, tle.epoch_ + 86400, steps[ss]);
+        EphemCodecOptions options;
+        writeEphemCompressed("tmp.ceph", ephem, options);
+        writeEphemToBinary("tmp.beph", ephem);
+        writeEphemToAGI("tmp.e", ephem);
+
+        CompressedEphemeris compressed("tmp.ceph");
+        Ephemeris decoded = compressed.toEphemeris();
+        printf("step %gs: %d states, %.1f bytes per state, %.1fx smaller than binary, %.1fx smaller than AGI\n",
+            steps[ss], compressed.numStates(), (double)fileSize("tmp.ceph")/ephem.states_.size(),
+            (double)fileSize("tmp.beph")/fileSize("tmp.ceph"), (double)fileSize("tmp.e")/fileSize("tmp.ceph"));
+        cout << "  values outside error bound = " << boundViolations(ephem, decoded, options) << " == 0" << endl;
+    }
+
+    // Random access decodes blocks lazily and matches the decoded ephemeris
+    Ephemeris ephem = ephemFromTLE(tle, tle.epoch_, tle.epoch_ + 86400, 10);
+    writeEphemCompressed("tmp.ceph", ephem);
+    CompressedEphemeris compressed("tmp.ceph");
+    Ephemeris decoded = compressed.toEphemeris();
+    vector<Timecode> times;
+    for (double tt = 3.7; tt < 86400; tt += 1234.5) {
+        times.push_back(tle.epoch_ + tt);
+    }
+    cout << "blocks = " << compressed.numBlocks() << endl;
+    cout << "cursor vs decoded max diff = " << maxStateDiff(compressed, decoded, times) << " == 0" << endl;
+    reverse(times.begin(), times.end());
+    cout << "backwards max diff = " << maxStateDiff(compressed, decoded, times) << " == 0" << endl;
+
+    // Random queries into an unevenly spaced ephemeris find their block from
+    // the index and decode at most the block holding the time and the next
+    Ephemeris uneven;
+    for (int ii = 0; ii < (int)ephem.states_.size(); ii += (ii < 2000) ? 1 : 10) uneven.states_.push_back(ephem.states_[ii]);
+    writeEphemCompressed("tmp2.ceph", uneven, EphemCodecOptions(1e-6, 1e-9, 1e-12, 64));
+    CompressedEphemeris random("tmp2.ceph");
+    long worst = 0;
+    for (int ii = 0; ii < 200; ii++) {
+        long before = random.blocksDecoded();
+        random.getSV(tle.epoch_ + fmod(ii*7919.3, 86390.0), 8);
+        worst = max(worst, random.blocksDecoded() - before);
+    }
+    cout << "most blocks decoded by a random query = " << worst << " <= 2" << endl;
+
+    StateVec sv0 = compressed.getSV(tle.epoch_ + 43210.5);
+    StateVec sv1 = ephem.getSV(tle.epoch_ + 43210.5);
+    cout << "interpolated pos diff from original = " << (sv0.pos_ - sv1.pos_).mag() << " < 1e-5" << endl;
+
+    // Hermite with accelerations, small blocks and threads
+    ephem.interpMethod_ = HERMITE;
+    ephem.accValid_ = true;
+    for (int ii = 0; ii < (int)ephem.states_.size(); ii++) {
+        StateVec& sv = ephem.states_[ii];
+        sv.acc_ = sv.pos_*(-3.986004418e14/pow(sv.pos_.mag(), 3));
+    }
+    EphemCodecOptions options(1e-3, 1e-6, 1e-9, 100);
+    writeEphemCompressed("tmp.ceph", ephem, options);
+    writeEphemCompressed("tmp1.ceph", ephem, options, 4);
+    MappedFile file0("tmp.ceph"), file1("tmp1.ceph");
+    cout << "threaded file identical = " << (file0.size() == file1.size() && memcmp(file0.data(), file1.data(), file0.size()) == 0) << endl;
+
+    CompressedEphemeris compressed1("tmp1.ceph");
+    Ephemeris decoded1 = compressed1.toEphemeris(4);
+    cout << "hermite values outside error bound = " << boundViolations(ephem, decoded1, options) << " == 0" << endl;
+    cout << "hermite cursor vs decoded max diff = " << maxStateDiff(compressed1, decoded1, times) << " == 0" << endl;
+
+    // Reading any format by contents
+    writeEphemToBinary("tmp.beph", ephem);
+    writeEphemToAGI("tmp.e", ephem);
+    cout << "read " << readEphemFile("tmp.e").states_.size() << " AGI, " << readEphemFile("tmp.beph").states_.size()
+         << " binary and " << readEphemFile("tmp1.ceph").states_.size() << " compressed states" << endl;
+
+    try {
+        writeEphemCompressed("tmp.ceph", ephem, EphemCodecOptions(1e-12));
+    } catch (const char* ee) {
+        cout << ee << ", partial file left = " << (fileSize("tmp.ceph") >= 0) << endl;
+    }
+    try {
+        CompressedEphemeris bad("tmp.e");
+    } catch (const char* ee) {
+        cout << ee << endl;
+    }
+
+    return 0;
+}
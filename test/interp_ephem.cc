@@ -13,6 +13,62 @@ int main(int argc, char* args[]) {
 
     Ephemeris ephem1 = ephem0.interpToStep(10);
 
+    // Cursor sweep should match independent lookups
+    Ephemeris::Cursor cursor(ephem0);
+    double maxdiff = 0;
+    for (int ii = 0; ii < (int)ephem1.states_.size(); ii += 7) {
+        StateVec sv0 = cursor.getSV(ephem1.states_[ii].tc_);
+        StateVec sv1 = ephem0.getSV(ephem1.states_[ii].tc_);
+        maxdiff = fmax(maxdiff, (sv0.pos_ - sv1.pos_).mag());
+    }
+    cout << "cursor vs getSV max pos diff = " << maxdiff << " == 0" << endl;
+
+    // Threaded generation and resampling match the single threaded results
+    Ephemeris ephem2 = ephemFromTLE(tle, tle.epoch_, tle.epoch_ + 86400, 60, 4);
+    Ephemeris ephem3 = ephem0.interpToStep(10, 4, 4);
+    maxdiff = 0;
+    for (int ii = 0; ii < (int)ephem0.states_.size(); ii++) {
+        maxdiff = fmax(maxdiff, (ephem0.states_[ii].pos_ - ephem2.states_[ii].pos_).mag());
+    }
+    for (int ii = 0; ii < (int)ephem1.states_.size(); ii++) {
+        maxdiff = fmax(maxdiff, (ephem1.states_[ii].pos_ - ephem3.states_[ii].pos_).mag());
+    }
+    cout << "threaded max pos diff = " << maxdiff << " == 0" << endl;
+
+    // Batch lookup at arbitrary sorted times
+    vector<Timecode> times;
+    for (double tt = 5; tt < 86400; tt += 123.4) {
+        times.push_back(tle.epoch_ + tt);
+    }
+    vector<StateVec> svs;
+    ephem0.getSVs(times, svs);
+    maxdiff = 0;
+    for (int ii = 0; ii < (int)times.size(); ii++) {
+        maxdiff = fmax(maxdiff, (svs[ii].pos_ - ephem0.getSV(times[ii]).pos_).mag());
+    }
+    cout << "getSVs " << svs.size() << " states, max pos diff = " << maxdiff << " == 0" << endl;
+
+    // Hermite on a coarse circular orbit with consistent velocities
+    double rr = 7000e3;
+    double ww = sqrt(3.986004418e14/(rr*rr*rr));
+    Ephemeris circ;
+    for (int ii = 0; ii <= 60; ii++) {
+        double tt = ii*300.0;
+        circ.states_.push_back(StateVec(
+            tle.epoch_ + tt, Vec3(rr*cos(ww*tt), rr*sin(ww*tt), 0),
+            Vec3(-rr*ww*sin(ww*tt), rr*ww*cos(ww*tt), 0)
+        ));
+    }
+    for (int mm = 0; mm < 2; mm++) {
+        circ.interpMethod_ = (mm == 0) ? LAGRANGE : HERMITE;
+        double maxerr = 0;
+        for (double tt = 1000; tt < 17000; tt += 7.7) {
+            StateVec sv = circ.getSV(tle.epoch_ + tt, 6);
+            maxerr = fmax(maxerr, (sv.pos_ - Vec3(rr*cos(ww*tt), rr*sin(ww*tt), 0)).mag());
+        }
+        cout << ((mm == 0) ? "lagrange" : "hermite") << " 300s step max pos err = " << maxerr << " m" << endl;
+    }
+
     writeEphemToAGI("tmp.e", ephem0);
     writeEphemToAGI("tmp_10.e", ephem1);
     return 0;
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <vector>
+#include <fstream>
 using namespace std;
 
 #include "ephem_gen.h"
@@ -15,5 +16,75 @@ int main(int argc, char *argv[]) {
 
     writeEphemToAGI("tmp.e", ephem);
 
+    // Resample straight to file without building the 10s ephemeris
+    writeResampledToAGI("tmp_10.e", ephem, 10);
+    Ephemeris ephem10 = readEphemAGI("tmp_10.e");
+    cout << "resampled points = " << ephem10.states_.size() << " == 8641" << endl;
+
+
+    // Mapped reader gives the same states as scanning each line with sscanf
+    Ephemeris ephem1 = readEphemAGI("tmp.e");
+    ifstream infile("tmp.e");
+    string line;
+    Timecode epoch;
+    while (getline(infile, line) && line.find("EphemerisTimePosVel") == string::npos) {
+        if (line.compare(0, 14, "ScenarioEpoch ") == 0) epoch = Timecode::parseAGI(line.substr(14));
+    }
+    int mismatches = 0;
+    for (int ii = 0; ii < (int)ephem1.states_.size() && getline(infile, line); ii++) {
+        if (line.empty()) {
+            ii--;
+            continue;
+        }
+        double sec;
+        Vec3 pos, vel;
+        sscanf(line.c_str(), "%lf %lf %lf %lf %lf %lf %lf", &sec, &pos.x_, &pos.y_, &pos.z_, &vel.x_, &vel.y_, &vel.z_);
+        const StateVec& sv = ephem1.states_[ii];
+        if (sv.tc_ != epoch + sec) mismatches++;
+        if (sv.pos_.x_ != pos.x_ || sv.pos_.y_ != pos.y_ || sv.pos_.z_ != pos.z_) mismatches++;
+        if (sv.vel_.x_ != vel.x_ || sv.vel_.y_ != vel.y_ || sv.vel_.z_ != vel.z_) mismatches++;
+    }
+    cout << "read points = " << ephem1.states_.size() << " == " << ephem.states_.size() << endl;
+    cout << "mapped reader vs sscanf mismatches = " << mismatches << " == 0" << endl;
+
+    // Chunked parallel read of a larger file matches the serial read
+    Ephemeris ephemBig = ephemFromTLE(tle, tle.epoch_, tle.epoch_ + 30000, 1);
+    writeEphemToAGI("tmp_big.e", ephemBig);
+    Ephemeris ephemSerial = readEphemAGI("tmp_big.e");
+    Ephemeris ephemParallel = readEphemAGI("tmp_big.e", 4);
+    mismatches = 0;
+    for (int ii = 0; ii < (int)ephemSerial.states_.size(); ii++) {
+        StateVec sv0 = ephemSerial.states_[ii];
+        StateVec sv1 = ephemParallel.states_[ii];
+        if (sv0.tc_ != sv1.tc_ || (sv0.pos_ - sv1.pos_).mag() != 0 || (sv0.vel_ - sv1.vel_).mag() != 0) mismatches++;
+    }
+    cout << "parallel read points = " << ephemParallel.states_.size() << " == " << ephemSerial.states_.size() << endl;
+    cout << "parallel vs serial read mismatches = " << mismatches << " == 0" << endl;
+
+    // Buffered and parallel writers give the same bytes as fprintf
+    FILE* fp = fopen("tmp_ref.e", "w");
+    for (int ii = 0; ii < (int)ephemBig.states_.size(); ii++) {
+        StateVec& sv = ephemBig.states_[ii];
+        fprintf(
+            fp, "%.6lf %.6lf %.6lf %.6lf %.12lf %.12lf %.12lf\n", sv.tc_ - ephemBig.states_[0].tc_,
+            sv.pos_.x_, sv.pos_.y_, sv.pos_.z_, sv.vel_.x_, sv.vel_.y_, sv.vel_.z_
+        );
+    }
+    fclose(fp);
+    writeEphemToAGI("tmp_big4.e", ephemBig, 4);
+    ifstream ref("tmp_ref.e"), out1("tmp_big.e"), out4("tmp_big4.e");
+    string line1, line4;
+    while (getline(out1, line1) && line1 != "EphemerisTimePosVel");
+    while (getline(out4, line4) && line4 != "EphemerisTimePosVel");
+    mismatches = 0;
+    int rows = 0;
+    while (getline(ref, line)) {
+        getline(out1, line1);
+        getline(out4, line4);
+        if (line1 != line || line4 != line) mismatches++;
+        rows++;
+    }
+    cout << "rows = " << rows << ", writer vs fprintf mismatches = " << mismatches << " == 0" << endl;
+
     return 0;
 }
@@ -60,5 +60,71 @@ int main(int argc, char *argv[]) {
         cout << ephem.states_[ii].getStr() << endl;
     }
 
+    // Resonance checkpoints give the same states as integrating from epoch,
+    // for times in any order on both sides of epoch
+    int mismatches = 0;
+    for (int ii = 0; ii < 400; ii++) {
+        Timecode tc = tle.epoch_ + ((ii*7919) % 400 - 100)*97.3*60.0;
+        Vallado::elsetrec fresh = tle.satrec_;
+        fresh.atime = 0.0;
+        double pos1[3], vel1[3];
+        Vallado::sgp4(fresh, (tc - tle.epoch_)/60.0, pos1, vel1);
+        StateVec sv1 = tle.getState(tc);
+        for (int kk = 0; kk < 3; kk++) {
+            if (sv1.pos_[kk] != pos1[kk]*1000.0 || sv1.vel_[kk] != vel1[kk]*1000.0) mismatches++;
+        }
+    }
+    cout << "resonance checkpoints = " << tle.context_.resonance_.size() << endl;
+    cout << "resonance checkpoint mismatches = " << mismatches << " == 0" << endl;
+
+    // One TLE shared by several threads, each with its own context, matches
+    // integrating from epoch and isn't modified
+    const TLE shared(str1, str2);
+    Vallado::elsetrec before = shared.satrec_;
+    vector<int> threadMismatches(4, 0);
+    parallelFor(4, 4, [&](long begin, long end) {
+        for (long tt = begin; tt < end; tt++) {
+            Sgp4Context context;
+            for (int ii = 0; ii < 200; ii++) {
+                Timecode tc = shared.epoch_ + ((ii*7919 + tt*104729) % 400 - 100)*97.3*60.0;
+                Vallado::elsetrec fresh = before;
+                fresh.atime = 0.0;
+                double pos1[3], vel1[3];
+                Vallado::sgp4(fresh, (tc - shared.epoch_)/60.0, pos1, vel1);
+                StateVec sv1 = shared.getState(tc, context);
+                if (context.error_ != fresh.error) threadMismatches[tt]++;
+                for (int kk = 0; kk < 3; kk++) {
+                    if (sv1.pos_[kk] != pos1[kk]*1000.0 || sv1.vel_[kk] != vel1[kk]*1000.0) threadMismatches[tt]++;
+                }
+            }
+        }
+    });
+    mismatches = threadMismatches[0] + threadMismatches[1] + threadMismatches[2] + threadMismatches[3];
+    cout << "shared TLE mismatches = " << mismatches << " == 0" << endl;
+    const Vallado::elsetrec& after = shared.satrec_;
+    bool modified = after.atime != before.atime || after.xli != before.xli || after.xni != before.xni
+        || after.t != before.t || after.error != before.error || after.aycof != before.aycof
+        || after.xlcof != before.xlcof || after.con41 != before.con41;
+    cout << "shared TLE modified = " << modified << " == 0" << endl;
+
+    // Reinitializing with another gravity model matches parsing with it
+    TLE tle84(str1, str2, TleOptions(Vallado::wgs84));
+    TLE tle72to84 = tle;
+    tle72to84.reinit(TleOptions(Vallado::wgs84));
+    mismatches = 0;
+    double maxdiff = 0.0;
+    for (int ii = 0; ii < 100; ii++) {
+        Timecode tc = tle.epoch_ + ii*3600.0;
+        StateVec sv84 = tle84.getState(tc);
+        StateVec sv1 = tle72to84.getState(tc);
+        StateVec sv72 = tle.getState(tc);
+        for (int kk = 0; kk < 3; kk++) {
+            if (sv1.pos_[kk] != sv84.pos_[kk] || sv1.vel_[kk] != sv84.vel_[kk]) mismatches++;
+            maxdiff = max(maxdiff, fabs(sv84.pos_[kk] - sv72.pos_[kk]));
+        }
+    }
+    cout << "wgs84 reinit mismatches = " << mismatches << " == 0" << endl;
+    cout << "wgs72 vs wgs84 max position difference (m) = " << maxdiff << endl;
+
     return 0;
 }
@@ -0,0 +1,207 @@
+#include <iostream>
+#include <stdio.h>
+#include <algorithm>
+using namespace std;
+
+#include "ephem_gen.h"
+
+int main(int argc, char* argv[]) {
+    string str1 = "1 25544U 98067A   17211.50000000  .00002182  00000-0  40768-4 0  9990";
+    string str2 = "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563537";
+    TLE base = TLE(str1, str2);
+    double epoch = base.satrec_.jdsatepoch + base.satrec_.jdsatepochF - 2433281.5;
+
+    // Synthetic catalog spread over low, eccentric and deep space orbits
+    TleCatalog catalog;
+    int nsats = 3001;
+    for (int ii = 0; ii < nsats; ii++) {
+        TLE tle = base;
+        double revs = (ii % 7 == 0) ? 1.0 + (ii % 5)*0.3 : 11.0 + (ii % 50)*0.11;
+        double ecco = 0.0001 + (ii % 13)*0.004;
+        double incl = (5.0 + (ii % 170)) * pi/180;
+        double bstar = 1e-5*(ii % 9);
+        Vallado::sgp4init(
+            Vallado::wgs72, 'a', ii, epoch, bstar, 0, 0, ecco, fmod(ii*0.37, 2*pi),
+            incl, fmod(ii*0.91, 2*pi), revs*2*pi/1440.0, fmod(ii*0.53, 2*pi), tle.satrec_
+        );
+        tle.resolveVariant();
+        catalog.add(tle);
+    }
+
+    vector<Timecode> times;
+    for (int jj = 0; jj < 10; jj++) times.push_back(base.epoch_ + jj*600.0);
+
+    vector<StateVec> states;
+    catalog.exact_ = true;
+    catalog.propagate(times, states);
+
+    // Exact batch results match Vallado::sgp4 on each element set bit for bit
+    vector<TLE> tles = catalog.tles_;
+    int mismatches = 0, failures = 0;
+    for (size_t jj = 0; jj < times.size(); jj++) {
+        for (int ii = 0; ii < nsats; ii++) {
+            Vallado::elsetrec& satrec = tles[ii].satrec_;
+            double pos[3], vel[3];
+            Vallado::sgp4(satrec, (times[jj] - tles[ii].epoch_)/60.0, pos, vel);
+            if (satrec.error != 0) {
+                failures++;
+                if (catalog.errors_[jj*nsats + ii] != satrec.error) mismatches++;
+                continue;
+            }
+            const StateVec& sv1 = states[jj*nsats + ii];
+            for (int kk = 0; kk < 3; kk++) {
+                if (pos[kk]*1000.0 != sv1.pos_[kk] || vel[kk]*1000.0 != sv1.vel_[kk]) mismatches++;
+            }
+        }
+    }
+    cout << "failed propagations = " << failures << endl;
+    cout << "batch vs scalar mismatches = " << mismatches << " == 0" << endl;
+
+    // Threaded propagation gives the same states
+    vector<StateVec> states2;
+    catalog.propagate(times, states2, 4);
+    mismatches = 0;
+    for (size_t ii = 0; ii < states.size(); ii++) {
+        if ((states[ii].pos_ - states2[ii].pos_).mag() != 0) mismatches++;
+    }
+    cout << "threaded mismatches = " << mismatches << " == 0" << endl;
+
+    // Vectorized transcendentals stay within a micrometer of the exact states
+    // and fail the same propagations
+    vector<StateVec> fast;
+    vector<int> exactErrors = catalog.errors_;
+    catalog.exact_ = false;
+    catalog.propagate(times, fast, 4);
+    double maxpos = 0, maxvel = 0;
+    mismatches = 0;
+    for (size_t ii = 0; ii < states.size(); ii++) {
+        if (catalog.errors_[ii] != exactErrors[ii]) mismatches++;
+        if (exactErrors[ii] != 0) continue;
+        maxpos = fmax(maxpos, (fast[ii].pos_ - states[ii].pos_).mag());
+        maxvel = fmax(maxvel, (fast[ii].vel_ - states[ii].vel_).mag());
+    }
+    cout << "vector error code mismatches = " << mismatches << " == 0" << endl;
+    cout << "vector max pos diff = " << maxpos << " m < 1e-6" << endl;
+    cout << "vector max vel diff = " << maxvel << " m/s < 1e-9" << endl;
+
+    // Single precision screening stays close to the double precision states,
+    // leaving out non physical states of decayed objects
+    vector<ScreenState> screen;
+    catalog.propagateScreen(times, screen);
+    maxpos = 0;
+    maxvel = 0;
+    for (size_t ii = 0; ii < states.size(); ii++) {
+        if (catalog.errors_[ii] != 0 || states[ii].pos_.mag() > 5e7) continue;
+        Vec3 pos(screen[ii].pos_[0], screen[ii].pos_[1], screen[ii].pos_[2]);
+        Vec3 vel(screen[ii].vel_[0], screen[ii].vel_[1], screen[ii].vel_[2]);
+        maxpos = fmax(maxpos, (pos - states[ii].pos_).mag());
+        maxvel = fmax(maxvel, (vel - states[ii].vel_).mag());
+    }
+    cout << "screen max pos diff = " << maxpos << " m" << endl;
+    cout << "screen max vel diff = " << maxvel << " m/s" << endl;
+
+    // Screening error over a 30k object LEO catalog at the times documented
+    // on TleCatalog, against the exact double path
+    TleCatalog leo;
+    for (int ii = 0; ii < 30000; ii++) {
+        TLE tle = base;
+        Vallado::sgp4init(
+            Vallado::wgs72, 'a', ii, epoch, 1e-5*(ii % 9), 0, 0, 0.0001 + (ii % 13)*0.002, fmod(ii*0.37, 2*pi),
+            (20.0 + (ii % 80)) * pi/180, fmod(ii*0.91, 2*pi), (14.0 + (ii % 29)*0.07)*2*pi/1440.0, fmod(ii*0.53, 2*pi), tle.satrec_
+        );
+        tle.resolveVariant();
+        leo.add(tle);
+    }
+    leo.exact_ = true;
+    double days[] = {1, 7, 30};
+    double bounds[][3] = {{40, 200, 0.3}, {300, 1500, 2}, {1200, 6000, 8}};
+    for (int dd = 0; dd < 3; dd++) {
+        vector<Timecode> when(1, base.epoch_ + days[dd]*86400);
+        vector<StateVec> exact;
+        leo.propagate(when, exact);
+        vector<int> exactErrors = leo.errors_;
+        leo.propagateScreen(when, screen);
+
+        vector<double> poserr;
+        double velerr = 0;
+        for (size_t ii = 0; ii < exact.size(); ii++) {
+            if (exactErrors[ii] != 0 || leo.errors_[ii] != 0 || exact[ii].pos_.mag() > 5e7) continue;
+            Vec3 pos(screen[ii].pos_[0], screen[ii].pos_[1], screen[ii].pos_[2]);
+            Vec3 vel(screen[ii].vel_[0], screen[ii].vel_[1], screen[ii].vel_[2]);
+            poserr.push_back((pos - exact[ii].pos_).mag());
+            velerr = fmax(velerr, (vel - exact[ii].vel_).mag());
+        }
+        sort(poserr.begin(), poserr.end());
+        printf("%g days, %d objects: median %.0f m <= %g, 99.9%% %.0f m <= %g, max vel %.2f m/s <= %g\n",
+            days[dd], (int)poserr.size(), poserr[poserr.size()/2], bounds[dd][0],
+            poserr[poserr.size()*999/1000], bounds[dd][1], velerr, bounds[dd][2]);
+    }
+
+    // Time vectorized ephemeris generation matches stepping one time at a
+    // time, exactly in exact mode
+    Ephemeris ephem = ephemFromTLE(base, base.epoch_, base.epoch_ + 86400, 10);
+    vector<StateVec> exact(ephem.states_.size());
+    vector<Timecode> grid;
+    for (int ii = 0; ii < (int)ephem.states_.size(); ii++) grid.push_back(ephem.states_[ii].tc_);
+    propagateNearTimes(base, grid, 0, grid.size(), &exact[0], true);
+    Vallado::elsetrec satrec = base.satrec_;
+    double maxdiff = 0;
+    mismatches = 0;
+    for (int ii = 0; ii < (int)ephem.states_.size(); ii++) {
+        double pos[3], vel[3];
+        Timecode tc = ephem.states_[ii].tc_;
+        Vallado::sgp4(satrec, (tc - base.epoch_)/60.0, pos, vel);
+        StateVec sv(tc, Vec3(pos[0], pos[1], pos[2])*1000.0, Vec3(vel[0], vel[1], vel[2])*1000.0);
+        maxdiff = fmax(maxdiff, (sv.pos_ - ephem.states_[ii].pos_).mag());
+        if ((sv.pos_ - exact[ii].pos_).mag() != 0) mismatches++;
+        if ((sv.vel_ - exact[ii].vel_).mag() != 0) mismatches++;
+    }
+    cout << "time vectorized exact mismatches = " << mismatches << " == 0" << endl;
+    cout << "time vectorized max pos diff = " << maxdiff << " m < 1e-6" << endl;
+
+    catalog.exact_ = true;
+    catalog.propagate(base.epoch_ + 3600.0, states);
+    cout << states[1].getStr() << endl;
+    cout << tles[1].getState(base.epoch_ + 3600.0).getStr() << endl;
+
+    // Each TLE propagates through the path chosen for its variant
+    mismatches = 0;
+    for (int ii = 0; ii < nsats; ii++) {
+        TLE tle = catalog.tles_[ii];
+        Vallado::elsetrec satrec = tle.satrec_;
+        for (int jj = 0; jj < 5; jj++) {
+            Timecode tc = base.epoch_ + jj*1234.5;
+            double pos[3], vel[3];
+            Vallado::sgp4(satrec, (tc - tle.epoch_)/60.0, pos, vel);
+            StateVec sv = tle.getState(tc);
+            if (tle.satrec_.error != satrec.error) mismatches++;
+            if (satrec.error != 0) continue;
+            for (int kk = 0; kk < 3; kk++) {
+                if (pos[kk]*1000.0 != sv.pos_[kk] || vel[kk]*1000.0 != sv.vel_[kk]) mismatches++;
+            }
+        }
+    }
+    cout << "TLE variant vs Vallado::sgp4 mismatches = " << mismatches << " == 0" << endl;
+
+    // Catalog wide reinit matches reinitializing each TLE on its own
+    catalog.reinit(TleOptions(Vallado::wgs84), 4);
+    catalog.propagate(times, states);
+    mismatches = 0;
+    for (int ii = 0; ii < nsats; ii++) {
+        TLE tle = tles[ii];
+        tle.reinit(TleOptions(Vallado::wgs84));
+        for (size_t jj = 0; jj < times.size(); jj++) {
+            StateVec sv = tle.getState(times[jj]);
+            if (tle.satrec_.error != 0) {
+                if (catalog.errors_[jj*nsats + ii] != tle.satrec_.error) mismatches++;
+                continue;
+            }
+            for (int kk = 0; kk < 3; kk++) {
+                if (sv.pos_[kk] != states[jj*nsats + ii].pos_[kk] || sv.vel_[kk] != states[jj*nsats + ii].vel_[kk]) mismatches++;
+            }
+        }
+    }
+    cout << "wgs84 catalog reinit mismatches = " << mismatches << " == 0" << endl;
+
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <iostream>
+#include <stdio.h>
+#include <float.h>
+using namespace std;
+
+#include "simd_pack.h"
+
+/**
+ * Largest differences of VectorMath from libm over arguments spread across
+ * [-range, range], absolute for sin, cos and fmod and relative for atan2
+ */
+template <class T, int W>
+void compareLibm(const char* name, double range, double eps) {
+    typedef Pack<T, W> P;
+    double maxsin = 0, maxcos = 0, maxatan = 0, maxfmod = 0, maxpow = 0;
+    int floorMismatches = 0;
+    const int nn = 100000;
+    for (int ii = 0; ii < nn; ii += W) {
+        P aa, bb;
+        for (int ll = 0; ll < W; ll++) {
+            double frac = (double)(ii + ll)/nn;
+            aa[ll] = (T)(range*(2*frac - 1));
+            bb[ll] = (T)(range*(2*fmod(frac*7919, 1.0) - 1));
+        }
+
+        P ss, cc;
+        VectorMath::sincos(aa, ss, cc);
+        P at = VectorMath::atan2(aa, bb);
+        P md = VectorMath::fmod(aa, (T)(2*M_PI));
+        P pw = VectorMath::powThreeHalves(fabs(aa));
+        P fl = floor(aa*(T)3.7);
+        for (int ll = 0; ll < W; ll++) {
+            maxsin = fmax(maxsin, fabs(ss[ll] - std::sin(aa[ll])));
+            maxcos = fmax(maxcos, fabs(cc[ll] - std::cos(aa[ll])));
+            T ref = std::atan2(aa[ll], bb[ll]);
+            maxatan = fmax(maxatan, fabs(at[ll] - ref)/fmax(fabs(ref), 1e-300));
+
+            // fmod can land on either side of a multiple, which is the same angle
+            T rem = std::fmod(aa[ll], (T)(2*M_PI));
+            double diff = fabs(md[ll] - rem);
+            maxfmod = fmax(maxfmod, fmin(diff, fabs(diff - 2*M_PI))/fmax(fabs(aa[ll]), 1.0));
+            T pref = std::pow(fabs(aa[ll]), (T)1.5);
+            if (pref > 0) maxpow = fmax(maxpow, fabs(pw[ll] - pref)/pref);
+            if (fl[ll] != std::floor(aa[ll]*(T)3.7)) floorMismatches++;
+        }
+    }
+    printf("%s sin %.2g cos %.2g atan2 %.2g fmod %.2g pow %.2g eps\n", name,
+        maxsin/eps, maxcos/eps, maxatan/eps, maxfmod/eps, maxpow/eps);
+    cout << "  floor mismatches = " << floorMismatches << " == 0" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    compareLibm<double, 4>("double x4 to 10", 10, DBL_EPSILON);
+    compareLibm<double, 8>("double x8 to 5000", 5000, DBL_EPSILON);
+    compareLibm<float, 8>("float x8 to 10", 10, FLT_EPSILON);
+    compareLibm<float, 16>("float x16 to 5000", 5000, FLT_EPSILON);
+
+    // Lanes beyond the reduction range go through libm, special cases of atan2
+    Pack<double, 4> big(0.0), yy(0.0), xx(0.0);
+    big[1] = 1e12;
+    big[2] = -3e15;
+    yy[1] = 1; yy[2] = -1; xx[3] = -1;
+    Pack<double, 4> ss = VectorMath::sin(big), at = VectorMath::atan2(yy, xx);
+    int mismatches = 0;
+    for (int ll = 0; ll < 4; ll++) {
+        if (ss[ll] != std::sin(big[ll])) mismatches++;
+        if (fabs(at[ll] - std::atan2(yy[ll], xx[ll])) > 4*DBL_EPSILON) mismatches++;
+    }
+    cout << "large argument and atan2 axis mismatches = " << mismatches << " == 0" << endl;
+
+    // Masks and selects
+    Pack<float, 8> aa(1.0f);
+    aa[3] = -2.0f;
+    Pack<float, 8>::mask_type neg = aa < 0.0f;
+    Pack<float, 8> pick = select(neg, Pack<float, 8>(5.0f), aa);
+    cout << "any = " << neg.any() << " " << ((!neg) & neg).any() << ", pick = " << pick[2] << " " << pick[3] << endl;
+
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <math.h>
 using namespace std;
 
 #include "string_extra.h"
@@ -15,5 +16,47 @@ int main(int argc, char* argv[]) {
     for (int ii = 0; ii < (int)tmp.size(); ii++) {
         cout << tmp[ii] << endl;
     }
+
+    // Number scanner agrees with strtod on fixed, long and exponent formats
+    const char* formats[] = {"%.6f", "%.12f", "%.17g", "%.3e", "%.0f", "%+.9f"};
+    int mismatches = 0;
+    for (int ii = 0; ii < 600000; ii++) {
+        double xx = (ii % 2 ? -1.0 : 1.0) * pow(10.0, (ii % 23) - 8) * (1.0 + (ii*0.6180339887) - (int)(ii*0.6180339887));
+        char buf[64];
+        int len = snprintf(buf, sizeof(buf), formats[ii % 6], xx);
+        double val1, val2 = strtod(buf, NULL);
+        const char* end = scanDouble(buf, buf + len, &val1);
+        if (end != buf + len || memcmp(&val1, &val2, sizeof(double)) != 0) mismatches++;
+    }
+    cout << "scanDouble vs strtod mismatches = " << mismatches << " == 0" << endl;
+
+    str = "  -0.000000\t12.5e3 .5 x";
+    const char* pos = str.c_str();
+    const char* end = pos + str.size();
+    double val;
+    while ((pos = scanDouble(pos, end, &val)) != NULL) cout << val << " ";
+    cout << endl;
+
+    // Fixed formatting matches snprintf, including ties and negative zero
+    mismatches = 0;
+    for (int ii = 0; ii < 600000; ii++) {
+        double xx = (ii % 2 ? -1.0 : 1.0) * pow(10.0, (ii % 25) - 12) * (1.0 + (ii*0.6180339887) - (int)(ii*0.6180339887));
+        if (ii % 5 == 0) xx = (ii % 3 ? -1.0 : 1.0) * ldexp((double)(ii/5), -(ii % 40));
+        int prec = (ii % 3 == 0) ? 6 : (ii % 3 == 1) ? 12 : ii % 20;
+        char buf1[400], buf2[400];
+        int len1 = formatFixed(buf1, xx, prec);
+        int len2 = snprintf(buf2, sizeof(buf2), "%.*f", prec, xx);
+        if (len1 != len2 || memcmp(buf1, buf2, len1) != 0) mismatches++;
+    }
+    cout << "formatFixed vs snprintf mismatches = " << mismatches << " == 0" << endl;
+
+    double vals[] = {0.0078125, -0.0, -0.0000004, 2.5, 1e300, -INFINITY};
+    for (int ii = 0; ii < 6; ii++) {
+        char buf[400];
+        buf[formatFixed(buf, vals[ii], (ii == 3) ? 0 : 6)] = '\0';
+        cout << buf << " ";
+    }
+    cout << endl;
+
     return 0;
 }
@@ -0,0 +1,63 @@
+#include <iostream>
+#include <stdio.h>
+using namespace std;
+
+#include "tle_archive.h"
+
+int main(int argc, char* argv[]) {
+    // Archive of 500 satellites with 20 element sets each, written out of
+    // epoch order with title lines and some CRLF line endings
+    FILE* fp = fopen("tmp.tle", "w");
+    for (int kk = 0; kk < 20; kk++) {
+        int day = 100 + (kk*7) % 20;
+        for (int ii = 0; ii < 500; ii++) {
+            const char* eol = (ii % 3 == 0) ? "\r\n" : "\n";
+            fprintf(fp, "SAT %d%s", ii, eol);
+            fprintf(fp, "1 %05dU 98%03dA   17%03d.50000000  .00002182  00000-0  40768-4 0  9990%s", 10000 + ii, ii, day, eol);
+            fprintf(fp, "2 %05d  51.6416 247.4627 0006703 130.5360 325.0288 %11.8f563537%s", 10000 + ii, 14.0 + day*0.01, eol);
+        }
+    }
+    fclose(fp);
+
+    TleArchive archive("tmp.tle", 4);
+    cout << "element sets = " << archive.size() << " == 10000" << endl;
+    cout << "satellites = " << archive.numSatellites() << " == 500" << endl;
+
+    // Newest element set for every satellite matches a brute force search
+    // over every record in file order
+    vector<TLE> tles;
+    for (size_t ii = 0; ii < archive.size(); ii++) tles.push_back(archive.getRecord(ii));
+    int mismatches = 0;
+    vector<long> ids = archive.satnums();
+    for (int ii = 0; ii < (int)ids.size(); ii++) {
+        int best = -1;
+        for (int jj = 0; jj < (int)tles.size(); jj++) {
+            if (tles[jj].satrec_.satnum != ids[ii]) continue;
+            if (best < 0 || tles[best].epoch_ <= tles[jj].epoch_) best = jj;
+        }
+        TLE tle = archive.get(ids[ii]);
+        if (tle.line0_ != tles[best].line0_ || tle.line1_ != tles[best].line1_) mismatches++;
+    }
+    cout << "newest TLE mismatches = " << mismatches << " == 0" << endl;
+
+    // Scan results don't depend on the number of threads
+    TleArchive archive1("tmp.tle", 1);
+    mismatches = 0;
+    for (size_t ii = 0; ii < archive.size(); ii++) {
+        if (archive.getRecord(ii).line0_ != archive1.getRecord(ii).line0_) mismatches++;
+    }
+    cout << "threaded scan mismatches = " << mismatches << " == 0" << endl;
+
+    TLE tle = archive.get("98123A");
+    cout << tle.line0_ << endl;
+    cout << tle.line1_ << endl;
+    cout << tle.epoch_.getStr() << endl;
+
+    try {
+        archive.get(99999);
+    } catch (const char* ee) {
+        cout << ee << endl;
+    }
+
+    return 0;
+}
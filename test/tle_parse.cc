@@ -0,0 +1,121 @@
+#include <iostream>
+#include <stdio.h>
+using namespace std;
+
+#include "sgp4.h"
+#include "parallel.h"
+
+/**
+ * Fills in column 69 of a line with its checksum
+ */
+void setChecksum(char* line) {
+    int sum = 0;
+    for (int ii = 0; ii < 68; ii++) {
+        if (line[ii] >= '0' && line[ii] <= '9') sum += line[ii] - '0';
+        else if (line[ii] == '-') sum++;
+    }
+    line[68] = '0' + sum % 10;
+}
+
+/**
+ * Builds a pair of well formed element lines with fields varied by ii
+ */
+void makeLines(int ii, char* line1, char* line2) {
+    const char* desigs[] = {"98067A  ", "05036A  ", "17001BCD", "        ", "61001A  "};
+    const char signs[] = {' ', '-', '+'};
+    snprintf(line1, 80, "1 %05d%c %s %02d%012.8f %c.%08d %c%05d%c%d %c%05d%c%d %d %4d0",
+        ii % 100000, (ii % 4 == 0) ? ' ' : 'U', desigs[ii % 5], (ii*7) % 100, 1.0 + (ii*0.7371) - 365.0*(int)(ii*0.7371/365.0),
+        (ii % 2) ? '-' : ' ', (ii*7919) % 100000000,
+        signs[ii % 3], (ii*31) % 100000, (ii % 5 == 0) ? '+' : '-', ii % 10,
+        signs[(ii/3) % 3], (ii*17) % 100000, (ii % 7 == 0) ? '+' : '-', (ii/7) % 10,
+        ii % 2, ii % 10000
+    );
+    snprintf(line2, 80, "2 %05d %8.4f %8.4f %07d %8.4f %8.4f %11.8f%5d0",
+        ii % 100000, fmod(ii*1.37, 180.0), fmod(ii*2.71, 360.0), (ii*7331) % 10000000,
+        fmod(ii*3.14, 360.0), fmod(ii*5.77, 360.0), 0.9 + fmod(ii*0.0173, 16.0), ii % 100000
+    );
+    setChecksum(line1);
+    setChecksum(line2);
+}
+
+/**
+ * Compares the parsed fields and initialized constants of two element sets
+ */
+bool sameElements(const Vallado::elsetrec& aa, const Vallado::elsetrec& bb) {
+    return aa.satnum == bb.satnum && aa.classification == bb.classification
+        && strcmp(aa.intldesg, bb.intldesg) == 0 && aa.epochyr == bb.epochyr
+        && aa.epochdays == bb.epochdays && aa.jdsatepoch == bb.jdsatepoch
+        && aa.jdsatepochF == bb.jdsatepochF && aa.ndot == bb.ndot && aa.nddot == bb.nddot
+        && aa.bstar == bb.bstar && aa.ephtype == bb.ephtype && aa.elnum == bb.elnum
+        && aa.revnum == bb.revnum && aa.inclo == bb.inclo && aa.nodeo == bb.nodeo
+        && aa.ecco == bb.ecco && aa.argpo == bb.argpo && aa.mo == bb.mo
+        && aa.no_kozai == bb.no_kozai && aa.no_unkozai == bb.no_unkozai && aa.cc1 == bb.cc1
+        && aa.method == bb.method && aa.isimp == bb.isimp && aa.error == bb.error;
+}
+
+int main(int argc, char* argv[]) {
+    // Fast parser matches twoline2rv on a spread of well formed lines
+    int ntles = 20000;
+    int mismatches = 0;
+    for (int ii = 0; ii < ntles; ii++) {
+        char line1[80], line2[80];
+        makeLines(ii, line1, line2);
+
+        char cstr1[130], cstr2[130];
+        strcpy(cstr1, line1);
+        strcpy(cstr2, line2);
+        Vallado::elsetrec ref;
+        double startmfe, stopmfe, deltamin;
+        Vallado::twoline2rv(cstr1, cstr2, 'c', 'm', 'a', Vallado::wgs72, startmfe, stopmfe, deltamin, ref);
+
+        Vallado::elsetrec satrec;
+        const char* error = parseTLE(TextSpan(line1, 69), TextSpan(line2, 69), TleOptions(), satrec, startmfe, stopmfe, deltamin);
+        if (error != NULL || !sameElements(ref, satrec)) {
+            if (mismatches++ < 5) cout << line1 << endl << line2 << endl;
+        }
+    }
+    cout << "parser vs twoline2rv mismatches = " << mismatches << " == 0" << endl;
+
+    // Verification run times come from the end of line 2
+    string str1 = "1 25544U 98067A   17211.50000000  .00002182  00000-0  40768-4 0  9990";
+    string str2 = "2 25544  51.6416 247.4627 0006703 130.5360 325.0288 15.72125391563537";
+    TLE tlev(str1, str2 + "    -1440.0 1440.0 20.0", TleOptions(Vallado::wgs72, 'a', 'v'));
+    cout << tlev.startmfe_ << " " << tlev.stopmfe_ << " " << tlev.deltamin_ << endl;
+
+    // Checksums are only enforced when asked for
+    char line1[80], line2[80];
+    makeLines(12345, line1, line2);
+    TLE good(line1, line2, TleOptions(Vallado::wgs72, 'a', 'c', true));
+    cout << "checksum ok = " << tleChecksumOk(line1) << " " << tleChecksumOk(str1.c_str()) << endl;
+    TLE unchecked(str1, str2);
+    try {
+        TLE bad(str1, str2, TleOptions(Vallado::wgs72, 'a', 'c', true));
+    } catch (const char* ee) {
+        cout << ee << endl;
+    }
+    try {
+        TLE bad(str1.substr(0, 60), str2);
+    } catch (const char* ee) {
+        cout << ee << endl;
+    }
+
+    // Parsing from many threads at once gives the same element sets
+    vector<Vallado::elsetrec> satrecs(ntles);
+    parallelFor(ntles, 4, [&](long begin, long end) {
+        for (long ii = begin; ii < end; ii++) {
+            char line1[80], line2[80];
+            double startmfe, stopmfe, deltamin;
+            makeLines(ii, line1, line2);
+            parseTLE(TextSpan(line1, 69), TextSpan(line2, 69), TleOptions(), satrecs[ii], startmfe, stopmfe, deltamin);
+        }
+    });
+    mismatches = 0;
+    for (int ii = 0; ii < ntles; ii++) {
+        makeLines(ii, line1, line2);
+        TLE tle(TextSpan(line1, 69), TextSpan(line2, 69));
+        if (!sameElements(tle.satrec_, satrecs[ii])) mismatches++;
+    }
+    cout << "threaded parse mismatches = " << mismatches << " == 0" << endl;
+
+    return 0;
+}